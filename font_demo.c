@@ -174,16 +174,21 @@ int main() {
         0                               /* 文本框高度 */
     );
 
-    /* 测试多行文本提示（需自行实现换行逻辑） */ 
+    /* 测试多行文本（lcd_layout 自动换行） */ 
     lcd_draw_filled_rounded_rectangle(
         520, 340,                           /* 左上角坐标 (x, y) */
         240, 140,                           /* 矩形宽度和高度 */
         15,                                 /* 圆角半径 */
         COLOR_LIGHTGRAY                     /* 填充颜色 */
     );
-    lcd_render_text("第一行文本", 535, 360, COLOR_RED, 40);
-    lcd_render_text("第二行文本", 535, 390, COLOR_RED, 40);
-    lcd_render_text("第三行文本", 535, 420, COLOR_RED, 40);
+    lcd_layout_t *layout = lcd_layout_create(
+        "多行文本按框宽自动换行，句号不会出现在行首。",   /* 文本内容 */
+        30,                                 /* 字体大小 */
+        210,                                /* 最大行宽 */
+        2                                   /* 行间距 */
+    );
+    lcd_layout_draw(layout, 535, 355, 210, 115, COLOR_RED);
+    lcd_layout_destroy(layout);
 
     /* 署名测试 */ 
     lcd_render_text("电科1223", 800, 340, COLOR_WHITE, 40);
@@ -22,6 +22,16 @@ Log:1.Optimize code comments and remove some useless code.
 #include <fcntl.h>
 #include <unistd.h>
 #include <math.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <pthread.h>
+
+/* UTF-8 解码的 ASCII 批量路径 */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
 
 /* 基于 TrueType 字体的开源库 */
 #define STB_TRUETYPE_IMPLEMENTATION
@@ -38,12 +48,65 @@ typedef struct {
     int height;     /* 屏幕高度（宽） */
 } LcdDevice;
 
+/*
+* 字体注册表
+* lcd_font_load 只登记字体文件路径与集合内序号，字体在第一次使用时才读取和解析：主字体在 lcd_set_font 选用时，
+* 后备字体在主字体缺字、第一次查找到它时。同一文件中的多个字体（.ttc 字体集合）共用一份文件内容。
+* 字体按引用计数释放，调用者持有的句柄与字体链中的位置各算一个引用。
+* 字体链 chain[0] 是当前字体（主字体），其后依次是后备字体。每个字体解析时由 cmap 生成 BMP 覆盖位图，
+* 为某个码点选择字体只需逐个字体测试一位，主字体包含该字符时只测试一次。
+*/
+#define FONT_MAX    16          /* 同时登记的字体数量上限，也是字体链长度的上限 */
+
+/* 字体状态 */
+enum {
+    FONT_UNLOADED,  /* 已登记，尚未解析 */
+    FONT_READY,     /* 已解析，可以使用 */
+    FONT_FAILED,    /* 文件无法读取或不是有效字体，不再重试 */
+    FONT_LOADING    /* 正在后台线程中解析 */
+};
+
+/* 字体文件，同一文件中的多个字体共用 */
+typedef struct {
+    char *path;                 /* 文件路径，为 NULL 表示该项空闲 */
+    unsigned char *data;        /* 文件内容 */
+    int refs;                   /* 使用该文件的已解析字体数量 */
+} FontFile;
+
+/* 字体 */
+struct lcd_font {
+    char *path;                 /* 字体文件路径，为 NULL 表示该项空闲 */
+    int index;                  /* 字体在字体集合中的序号，单个字体的文件为 0 */
+    int refs;                   /* 引用计数 */
+    int state;                  /* 字体状态 */
+    int file;                   /* 文件内容所在的 font_files 项 */
+    stbtt_fontinfo info;        /* 字体信息 */
+    uint32_t *coverage;         /* BMP 覆盖位图，每个码点一位 */
+    float em_scale;             /* 字高为 1 像素时的缩放比例，用于换算各字体的字形尺寸 */
+};
+
 /* 全局变量 */
 static LcdDevice *lcd = NULL;               /* 存储当前 LCD 设备的信息 */
-static stbtt_fontinfo font;                 /* 存储字体信息 */
-static unsigned char *font_buffer = NULL;   /* 存储字体文件的内存缓冲区 */
+static lcd_surface_t screen = { LCD_FORMAT_RGB565, 0, 0, 0, NULL };  /* 描述 LCD 映射内存的表面 */
+static lcd_surface_t *target = &screen;     /* 当前绘制目标，所有绘制函数都绘制到该表面 */
+static lcd_font_t faces[FONT_MAX];          /* 已登记的字体，数组下标即字体序号 */
+static FontFile font_files[FONT_MAX];       /* 已读取的字体文件 */
+static int chain[FONT_MAX];                 /* 字体链：主字体与后备字体的字体序号 */
+static int chain_count = 0;                 /* 字体链长度 */
+static unsigned int fallback_serial = 0;    /* 后备字体每次变化时递增，字符串缓存以此区分字体链 */
+static stbtt_fontinfo *font = NULL;         /* 主字体信息，行高、基线等垂直度量均以主字体为准 */
 static int font_size = 24;                  /* 字体大小初始值为 24 */
 
+/* 依赖当前字体与屏幕的缓存，在 lcd_cleanup 中释放（定义见下文） */
+static void font_caches_clear(void);
+static void font_caches_drop(int face);
+static void font_swap_cancel(void);
+static void page_cache_clear(void);
+static void number_cache_clear(void);
+
+/* 解析字体（定义见下文），后备字体在第一次查找到它时解析 */
+static int face_parse(lcd_font_t *face);
+
 /* 初始化 LCD 设备 */ 
 static LcdDevice* init_lcd_device(const char *lcd_path, int width, int height) {
     LcdDevice *device = (LcdDevice*)malloc(sizeof(LcdDevice));      /* 使用 malloc 函数为 LcdDevice 结构体分配内存 */
@@ -88,97 +151,707 @@ static void free_lcd_device(LcdDevice *device) {
     }
 }
 
-/* 
+/*
 * UTF-8 解码函数
 * str：指向 UTF-8 编码字符串的指针，作为函数的输入参数。
+* len：str 之后可读取的字节数（至少为 1），解码不会越过这一范围。
 * codepoint：指向整数的指针，用于存储解码后的 Unicode 码点。
-*/ 
-static int decode_utf8(const char *str, int *codepoint) {   
-    unsigned char c = (unsigned char)*str;  /* c：用于存储当前字符的第一个字节 */
-    int len = 1;    /* len：用于存储当前字符的字节长度，初始化为 1，因为单字节 UTF-8 字符占用 1 个字节 */
-    
-    /* UTF-8 编码规则进行解码 */
-    if (c < 0x80) {                     /* 单字节字符（ASCII 字符） */
+* 返回值：消耗的字节数。非法首字节、缺少后续字节（包括被 len 截断）、后续字节不以 10 开头、
+*        超长编码、代理区码点和超过 U+10FFFF 的码点均解码为 U+FFFD，此时只消耗已检查过的合法前缀，
+*        下一个字符从第一个不合法的字节重新开始。超长编码、代理区与超过 U+10FFFF 的码点在第二个字节
+*        即可判定（如 E0 80、ED A0、F4 90），因此只消耗首字节，其后的每个后续字节各自解码为 U+FFFD。
+*/
+static inline int decode_utf8(const char *str, int len, int *codepoint) {
+    const unsigned char *s = (const unsigned char*)str;
+    unsigned char c = s[0];     /* c：当前字符的第一个字节 */
+
+    if (c < 0x80) {             /* 单字节字符（ASCII 字符） */
         *codepoint = c;
-    } else if ((c & 0xE0) == 0xC0) {    /* 双字节字符 */
-        *codepoint = ((c & 0x1F) << 6) | (str[1] & 0x3F);
-        len = 2;
-    } else if ((c & 0xF0) == 0xE0) {    /* 三字节字符 */
-        *codepoint = ((c & 0x0F) << 12) | ((str[1] & 0x3F) << 6) | (str[2] & 0x3F);
-        len = 3;
-    } else if ((c & 0xF8) == 0xF0) {    /* 四字节字符 */
-        *codepoint = ((c & 0x07) << 18) | ((str[1] & 0x3F) << 12) | 
-                      ((str[2] & 0x3F) << 6) | (str[3] & 0x3F);
-        len = 4;
+        return 1;
+    }
+
+    /* 完整且合法的三字节字符（中文的常见情况）一次检查两个后续字节，其余情况交给逐字节校验 */
+    if ((c & 0xF0) == 0xE0 && len >= 3 && ((s[1] & 0xC0) | ((s[2] & 0xC0) >> 2)) == 0xA0) {
+        int cp = ((c & 0x0F) << 12) | ((s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+        if (cp >= 0x800 && (cp < 0xD800 || cp > 0xDFFF)) {
+            *codepoint = cp;
+            return 3;
+        }
+    }
+
+    /* 后续字节数、已解码的位、第二个字节的取值范围（排除超长编码、代理区和超过 U+10FFFF 的码点） */
+    int need, cp, lo = 0x80, hi = 0xBF;
+    if (c >= 0xC2 && c <= 0xDF) {           /* 双字节字符（C0、C1 只能构成超长编码） */
+        need = 1; cp = c & 0x1F;
+    } else if ((c & 0xF0) == 0xE0) {        /* 三字节字符 */
+        need = 2; cp = c & 0x0F;
+        if (c == 0xE0) lo = 0xA0;           /* 超长编码 */
+        if (c == 0xED) hi = 0x9F;           /* 代理区 */
+    } else if (c >= 0xF0 && c <= 0xF4) {    /* 四字节字符 */
+        need = 3; cp = c & 0x07;
+        if (c == 0xF0) lo = 0x90;           /* 超长编码 */
+        if (c == 0xF4) hi = 0x8F;           /* 超过 U+10FFFF */
+    } else {                                /* 孤立的后续字节或非法首字节 */
+        *codepoint = 0xFFFD;
+        return 1;
+    }
+
+    for (int k = 1; k <= need; k++) {
+        if (k >= len || (s[k] & 0xC0) != 0x80 ||
+            (k == 1 && (s[1] < lo || s[1] > hi))) {     /* 序列被截断或不可能构成合法字符 */
+            *codepoint = 0xFFFD;
+            return k;
+        }
+        cp = (cp << 6) | (s[k] & 0x3F);
+    }
+    *codepoint = cp;
+    return need + 1;
+}
+
+/*
+* UTF-8 顺序解码器
+* 文本函数逐字符处理时需要当前字符和下一个字符（字距调整），解码器保证每个字符只解码一次。
+* ASCII 快速路径：以 16 字节为一块，用 SSE2 / NEON 一次求出块首连续 ASCII 的长度，
+* 此范围内的字节直接作为码点返回；其余字符逐个经 decode_utf8 校验解码。
+*/
+#define UTF8_CHUNK  16      /* ASCII 快速路径的块大小 */
+
+typedef struct {
+    const char *text;           /* 文本 */
+    int len;                    /* 文本字节数 */
+    int pos;                    /* 下一个未解码的字节 */
+    int ascii_end;              /* [pos, ascii_end) 已确认全为 ASCII */
+} Utf8Reader;
+
+/* 返回 p 开始的 16 个字节中，开头连续 ASCII 字节的数量 */
+static inline int utf8_ascii_prefix(const char *p) {
+#if defined(__SSE2__)
+    int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)p));
+    return mask ? __builtin_ctz(mask) : UTF8_CHUNK;
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    uint8x16_t v = vandq_u8(vld1q_u8((const uint8_t*)p), vdupq_n_u8(0x80));
+    uint64_t lo = vgetq_lane_u64(vreinterpretq_u64_u8(v), 0);
+    uint64_t hi = vgetq_lane_u64(vreinterpretq_u64_u8(v), 1);
+    if (lo) return __builtin_ctzll(lo) >> 3;
+    if (hi) return 8 + (__builtin_ctzll(hi) >> 3);
+    return UTF8_CHUNK;
+#else
+    int n = 0;
+    while (n < UTF8_CHUNK && !(p[n] & 0x80)) n++;
+    return n;
+#endif
+}
+
+/* 初始化顺序解码器 */
+static void utf8_reader_init(Utf8Reader *reader, const char *text, int len) {
+    reader->text = text;
+    reader->len = len;
+    reader->pos = 0;
+    reader->ascii_end = 0;
+}
+
+/* 取出下一个码点，返回它的字节偏移，文本结束时返回 -1 */
+static inline int utf8_next(Utf8Reader *reader, int *codepoint) {
+    int pos = reader->pos;
+    if (pos >= reader->ascii_end) {
+        if (pos >= reader->len) return -1;
+        if (reader->text[pos] & 0x80) {     /* 非 ASCII 字符 */
+            reader->pos = pos + decode_utf8(reader->text + pos, reader->len - pos, codepoint);
+            return pos;
+        }
+        reader->ascii_end = reader->len - pos >= UTF8_CHUNK ?
+                            pos + utf8_ascii_prefix(reader->text + pos) : pos + 1;
+    }
+    *codepoint = (unsigned char)reader->text[pos];
+    reader->pos = pos + 1;
+    return pos;
+}
+
+/*
+* 字形键
+* 码点经字体链选定字体后记为 码点 | (字体序号 << KEY_FACE_SHIFT)（非负）；
+* 主字体的字形索引 g 记为 -1 - (g | (字体序号 << KEY_GLYPH_SHIFT))（负数）。
+* 度量、字距调整和字形缓存都以字形键为准，字形键相同即字体与字形相同，切换主字体后各字体的缓存互不干扰。
+*/
+#define KEY_FACE_SHIFT      21                      /* 字体序号在码点字形键中的位置，码点占低 21 位 */
+#define KEY_GLYPH_SHIFT     16                      /* 字体序号在字形索引字形键中的位置，字形索引占低 16 位 */
+#define KEY_CODEPOINT(key)  ((key) & 0x1FFFFF)      /* 码点字形键中的码点 */
+#define GLYPH_KEY(glyph)    (-1 - ((glyph) | (chain[0] << KEY_GLYPH_SHIFT)))   /* 主字体字形索引对应的字形键 */
+
+/* 字体是否包含码点 codepoint：BMP 内查覆盖位图，其余查 cmap */
+static inline int face_covers(const lcd_font_t *face, int codepoint) {
+    if (codepoint < 0x10000) return (face->coverage[codepoint >> 5] >> (codepoint & 31)) & 1;
+    return stbtt_FindGlyphIndex(&face->info, codepoint) != 0;
+}
+
+/* 为码点选择字体，返回字形键。所有字体都不包含该字符时使用主字体（显示为 .notdef） */
+static inline int font_key(int codepoint) {
+    if (chain_count > 1 && codepoint >= 32 && !face_covers(&faces[chain[0]], codepoint)) {
+        for (int i = 1; i < chain_count; i++) {
+            lcd_font_t *face = &faces[chain[i]];
+            if (face_parse(face) == 0 && face_covers(face, codepoint)) return codepoint | (chain[i] << KEY_FACE_SHIFT);
+        }
+    }
+    return codepoint | (chain[0] << KEY_FACE_SHIFT);
+}
+
+/* 字体链标识：主字体序号与后备字体变化次数的组合，字体链相同时标识相同 */
+static inline unsigned int chain_id(void) {
+    return (unsigned int)chain[0] + FONT_MAX * fallback_serial;
+}
+
+/* 字形键所属的字体 */
+static inline const lcd_font_t *key_face(int key) {
+    return key < 0 ? &faces[(-1 - key) >> KEY_GLYPH_SHIFT] : &faces[key >> KEY_FACE_SHIFT];
+}
+
+/* 字形键所属字体与主字体的缩放比例之比，同一字体大小下各字体的字高一致 */
+static inline float key_ratio(int key) {
+    const lcd_font_t *face = key_face(key);
+    return face == &faces[chain[0]] ? 1.0f : face->em_scale / faces[chain[0]].em_scale;
+}
+
+/*
+* 文本输入源
+* 文本函数的输入可以是 UTF-8 字节串（给出字节数时不要求以 '\0' 结尾）、预先解码的 UTF-32 码点数组，
+* 或调用者预先排版得到的字形索引数组。输入源逐个给出字符的字形键，之后不再区分输入形式。
+*/
+enum {
+    TEXT_UTF8,      /* UTF-8 字节串 */
+    TEXT_UTF32,     /* UTF-32 码点数组 */
+    TEXT_GLYPH      /* 字形索引数组 */
+};
+
+typedef struct {
+    int kind;               /* 输入形式 */
+    const void *data;       /* 输入数据 */
+    int count;              /* 字节数（UTF-8）或元素个数 */
+    int pos;                /* 下一个元素（UTF-32、字形索引） */
+    Utf8Reader utf8;        /* UTF-8 顺序解码器 */
+} TextSource;
+
+/* 初始化输入源 */
+static void text_source_init(TextSource *src, int kind, const void *data, int count) {
+    src->kind = kind;
+    src->data = data;
+    src->count = count > 0 ? count : 0;
+    src->pos = 0;
+    if (kind == TEXT_UTF8) utf8_reader_init(&src->utf8, (const char*)data, src->count);
+}
+
+/* 输入数据的字节数 */
+static size_t text_source_bytes(const TextSource *src) {
+    if (src->kind == TEXT_UTF32) return (size_t)src->count * sizeof(uint32_t);
+    if (src->kind == TEXT_GLYPH) return (size_t)src->count * sizeof(uint16_t);
+    return (size_t)src->count;
+}
+
+/* 取出下一个字符的字形键，输入结束时返回 0。超出 Unicode 范围的 UTF-32 码点按 U+FFFD 处理 */
+static inline int text_next(TextSource *src, int *key) {
+    if (src->kind == TEXT_UTF8) {
+        if (utf8_next(&src->utf8, key) < 0) return 0;
+        *key = font_key(*key);
+        return 1;
+    }
+    if (src->pos >= src->count) return 0;
+    if (src->kind == TEXT_UTF32) {
+        uint32_t cp = ((const uint32_t*)src->data)[src->pos++];
+        *key = font_key((cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) ? 0xFFFD : (int)cp);
     } else {
-        *codepoint = 0xFFFD;            /* 无效字符 */ 
+        *key = GLYPH_KEY(((const uint16_t*)src->data)[src->pos++]);
     }
-    
-    return len;  /* 返回当前字符的字节长度 */
+    return 1;
 }
 
-/* 初始化字库 */ 
-int lcd_init(const char *lcd_path, const char *font_path) {
+/* 是否为不渲染的控制字符（码点小于 32），字形索引不属于控制字符 */
+static inline int key_is_control(int key) {
+    return key >= 0 && KEY_CODEPOINT(key) < 32;
+}
 
-    /* 释放现有资源（如果有） */ 
-    lcd_cleanup();
+/* 字形键在所属字体中的字形索引 */
+static inline int key_glyph(int key) {
+    return key < 0 ? (-1 - key) & 0xFFFF : stbtt_FindGlyphIndex(&key_face(key)->info, KEY_CODEPOINT(key));
+}
 
-    /* 初始化 LCD 设备 */ 
-    lcd = init_lcd_device(lcd_path, 1024, 600);  /* 假设屏幕分辨率为 1024x600 */
-    if (!lcd) {
-        return -1;
+/* 字形键的前进宽度（换算为主字体的字体单位，乘以主字体的缩放比例即为像素） */
+static float key_advance(int key) {
+    int advance, lsb;
+    if (key >= 0) {
+        stbtt_GetCodepointHMetrics(&key_face(key)->info, KEY_CODEPOINT(key), &advance, &lsb);
+    } else {
+        stbtt_GetGlyphHMetrics(&key_face(key)->info, key_glyph(key), &advance, &lsb);
+    }
+    return advance * key_ratio(key);
+}
+
+/* 两个字形键之间的字距调整（主字体的字体单位），不同字体的字符之间没有字距调整 */
+static float key_kern(int a, int b) {
+    const lcd_font_t *face = key_face(a);
+    if (face != key_face(b)) return 0;
+    if (a >= 0 && b >= 0) {
+        return stbtt_GetCodepointKernAdvance(&face->info, KEY_CODEPOINT(a), KEY_CODEPOINT(b)) * key_ratio(a);
+    }
+    return stbtt_GetGlyphKernAdvance(&face->info, key_glyph(a), key_glyph(b)) * key_ratio(a);
+}
+
+/* 字形键在主字体缩放比例 scale 下的位图包围盒 */
+static void key_bitmap_box(int key, float scale, float shift_x, int *x0, int *y0, int *x1, int *y1) {
+    float s = scale * key_ratio(key);
+    stbtt_GetGlyphBitmapBoxSubpixel(&key_face(key)->info, key_glyph(key), s, s, shift_x, 0, x0, y0, x1, y1);
+}
+
+/* 读取字体中的大端整数 */
+static inline unsigned int font_u16(const unsigned char *p) { return (p[0] << 8) | p[1]; }
+static inline unsigned int font_u32(const unsigned char *p) {
+    return ((unsigned int)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+/* 在覆盖位图中标记码点 */
+static inline void coverage_set(uint32_t *coverage, unsigned int codepoint) {
+    coverage[codepoint >> 5] |= 1u << (codepoint & 31);
+}
+
+/*
+* 生成 BMP 覆盖位图
+* 逻辑：直接遍历 stb_truetype 选定的 cmap 子表，格式 4 按段、格式 12/13 按组标记映射到非 0 字形的码点，
+*      判定规则与 stbtt_FindGlyphIndex 一致；其他格式逐个码点查询。
+*/
+static void face_build_coverage(lcd_font_t *face) {
+    const unsigned char *data = face->info.data;
+    unsigned int map = face->info.index_map;
+    unsigned int format = font_u16(data + map);
+
+    if (format == 4) {
+        unsigned int segcount = font_u16(data + map + 6) >> 1;
+        unsigned int ends = map + 14;                   /* 各段的结束码点 */
+        unsigned int starts = ends + segcount * 2 + 2;  /* 各段的起始码点 */
+        unsigned int deltas = starts + segcount * 2;    /* idDelta */
+        unsigned int ranges = deltas + segcount * 2;    /* idRangeOffset */
+        for (unsigned int i = 0; i < segcount; i++) {
+            unsigned int end = font_u16(data + ends + 2 * i);
+            unsigned int start = font_u16(data + starts + 2 * i);
+            unsigned int delta = font_u16(data + deltas + 2 * i);
+            unsigned int offset = font_u16(data + ranges + 2 * i);
+            for (unsigned int c = start; c <= end; c++) {
+                unsigned int glyph = offset == 0 ? ((c + delta) & 0xFFFF) :
+                                     font_u16(data + ranges + 2 * i + offset + (c - start) * 2);
+                if (glyph) coverage_set(face->coverage, c);
+            }
+        }
+    } else if (format == 12 || format == 13) {
+        unsigned int ngroups = font_u32(data + map + 12);
+        for (unsigned int i = 0; i < ngroups; i++) {
+            const unsigned char *group = data + map + 16 + i * 12;
+            unsigned int start = font_u32(group), end = font_u32(group + 4), glyph = font_u32(group + 8);
+            if (end > 0xFFFF) end = 0xFFFF;
+            for (unsigned int c = start; c <= end; c++) {
+                if (format == 12 ? glyph + (c - start) != 0 : glyph != 0) coverage_set(face->coverage, c);
+            }
+        }
+    } else {
+        for (int c = 0; c < 0x10000; c++) {
+            if (stbtt_FindGlyphIndex(&face->info, c)) coverage_set(face->coverage, c);
+        }
     }
+}
 
-    /* 读取字体文件 */ 
-    FILE *font_file = fopen(font_path, "rb");
+/* 读取整个字体文件，失败返回 NULL。不访问全局状态，可以在后台线程中调用 */
+static unsigned char *font_file_read(const char *path) {
+    FILE *font_file = fopen(path, "rb");
     if (!font_file) {
         perror("无法打开字体文件.");
-        lcd_cleanup();
-        return -1;
+        return NULL;
     }
     
     fseek(font_file, 0, SEEK_END);      /* 使用 fseek 和 ftell 确定字体文件的大小 */
     long font_size = ftell(font_file);
     fseek(font_file, 0, SEEK_SET);
-    font_buffer = (unsigned char*)malloc(font_size);
-    if (!font_buffer) {
+    unsigned char *data = (unsigned char*)malloc(font_size > 0 ? font_size : 1);
+    if (!data) {
         perror("malloc");
         fclose(font_file);
-        lcd_cleanup();
-        return -1;
+        return NULL;
     }
-    fread(font_buffer, 1, font_size, font_file);    /* 将字体文件内容读取到 font_buffer 中 */
+    fread(data, 1, font_size, font_file);   /* 将字体文件内容读取到 data 中 */
     fclose(font_file);  /* 关闭文件 */
+    return data;
+}
+
+/* 在 font_files 中查找已读取的文件，未读取时返回 -1 */
+static int font_file_find(const char *path) {
+    for (int i = 0; i < FONT_MAX; i++) {
+        if (font_files[i].path && strcmp(font_files[i].path, path) == 0) return i;
+    }
+    return -1;
+}
+
+/* 把已读取的文件内容登记到 font_files，返回序号；失败时释放 data 并返回 -1 */
+static int font_file_add(const char *path, unsigned char *data) {
+    for (int i = 0; i < FONT_MAX; i++) {
+        if (font_files[i].path) continue;
+        font_files[i].path = strdup(path);
+        if (!font_files[i].path) break;
+        font_files[i].data = data;
+        font_files[i].refs = 0;
+        return i;
+    }
+    free(data);
+    return -1;
+}
+
+/* 读取字体文件，同一文件只读取一次，返回 font_files 中的序号，失败返回 -1 */
+static int font_file_open(const char *path) {
+    int slot = font_file_find(path);
+    if (slot >= 0) return slot;
+    unsigned char *data = font_file_read(path);
+    return data ? font_file_add(path, data) : -1;
+}
+
+/* 减少字体文件的使用计数，没有字体使用时释放文件内容 */
+static void font_file_close(int slot) {
+    FontFile *file = &font_files[slot];
+    if (--file->refs > 0) return;
+    free(file->data);
+    free(file->path);
+    memset(file, 0, sizeof(FontFile));
+}
+
+/*
+* 由文件内容初始化字体信息与覆盖位图，成功返回 0
+* 逻辑：字体集合由 stbtt_GetFontOffsetForIndex 找到第 index 个字体的偏移，单个字体的文件只有序号 0。
+*      只写入 face 的 info、coverage 与 em_scale，可以在后台线程中调用。
+*/
+static int face_init(lcd_font_t *face, const unsigned char *data) {
+    int offset = stbtt_GetFontOffsetForIndex(data, face->index);
+    face->coverage = (uint32_t*)calloc(0x10000 / 32, sizeof(uint32_t));
+    if (offset < 0 || !face->coverage || !stbtt_InitFont(&face->info, data, offset)) {
+        fprintf(stderr, "无法初始化字体: %s (序号 %d)\n", face->path, face->index);
+        free(face->coverage);
+        face->coverage = NULL;
+        return -1;
+    }
+    face->em_scale = stbtt_ScaleForPixelHeight(&face->info, 1.0f);
+    face_build_coverage(face);
+    return 0;
+}
+
+/*
+* 解析字体，成功返回 0
+* 逻辑：已解析的字体直接返回；解析失败的字体记为 FONT_FAILED，之后不再重复读取文件。
+*      正在后台加载的字体暂不可用，返回 -1。
+*/
+static int face_parse(lcd_font_t *face) {
+    if (face->state == FONT_READY) return 0;
+    if (face->state != FONT_UNLOADED) return -1;
+
+    int file = font_file_open(face->path);
+    if (file < 0) {
+        face->state = FONT_FAILED;
+        return -1;
+    }
+    font_files[file].refs++;
+    if (face_init(face, font_files[file].data) != 0) {
+        font_file_close(file);
+        face->state = FONT_FAILED;
+        return -1;
+    }
+    face->file = file;
+    face->state = FONT_READY;
+    return 0;
+}
+
+/* 释放字体占用的全部资源，该项重新变为空闲 */
+static void face_free(lcd_font_t *face) {
+    if (face->state == FONT_READY) {
+        free(face->coverage);
+        font_file_close(face->file);
+    }
+    free(face->path);
+    memset(face, 0, sizeof(lcd_font_t));
+}
+
+/* 减少字体的引用计数，计数归零时卸载字体 */
+static void face_unref(lcd_font_t *face) {
+    if (--face->refs > 0) return;
+    font_caches_drop((int)(face - faces));     /* 字体序号会被之后登记的字体复用，先释放该字体的缓存 */
+    face_free(face);
+}
+
+/* 字体在字体链中的位置，不在字体链中返回 -1 */
+static int chain_find(const lcd_font_t *face) {
+    for (int i = 0; i < chain_count; i++) {
+        if (&faces[chain[i]] == face) return i;
+    }
+    return -1;
+}
+
+/* 登记字体 */
+lcd_font_t *lcd_font_load(const char *path, int index) {
+    /*
+    * 功能：登记字体文件中的第 index 个字体并返回句柄，此时不读取文件。
+    * 逻辑：同一文件与序号已登记时返回已有句柄并增加引用计数；否则占用一个空闲项。
+    */
+    if (!lcd || !path || index < 0) return NULL;
+    lcd_font_t *slot = NULL;
+    for (int i = 0; i < FONT_MAX; i++) {
+        lcd_font_t *face = &faces[i];
+        if (face->path && face->index == index && strcmp(face->path, path) == 0) {
+            face->refs++;
+            return face;
+        }
+        if (!face->path && !slot) slot = face;
+    }
+    if (!slot) return NULL;
 
-    /* 初始化字体信息 */ 
-    if (!stbtt_InitFont(&font, font_buffer, 0)) {
-        perror("无法初始化字体.");
+    slot->path = strdup(path);
+    if (!slot->path) {
+        perror("malloc");
+        return NULL;
+    }
+    slot->index = index;
+    slot->refs = 1;
+    slot->state = FONT_UNLOADED;
+    return slot;
+}
+
+/* 释放字体句柄 */
+void lcd_font_release(lcd_font_t *font) {
+    if (!font || !font->path) return;
+    face_unref(font);
+}
+
+/* 选用主字体 */
+int lcd_set_font(lcd_font_t *face) {
+    /*
+    * 功能：把字体设为当前字体，之后的文本函数都使用该字体，主字体缺少的字符仍在后备字体中查找。
+    * 逻辑：字体在此时解析，解析失败时保持原来的字体。字体链持有主字体的一个引用；
+    *      该字体原本是后备字体时从后备字体中移除。
+    */
+    if (!lcd || !face || !face->path || face_parse(face) != 0) return -1;
+    int pos = chain_find(face);
+    if (pos == 0) return 0;
+
+    face->refs++;
+    if (pos > 0) {              /* 从后备字体中移除 */
+        memmove(&chain[pos], &chain[pos + 1], (chain_count - pos - 1) * sizeof(int));
+        chain_count--;
+        fallback_serial++;
+        face->refs--;
+    }
+    lcd_font_t *old = chain_count > 0 ? &faces[chain[0]] : NULL;
+    if (!old) chain_count = 1;
+    chain[0] = (int)(face - faces);
+    font = &face->info;
+    if (old) face_unref(old);
+    return 0;
+}
+
+/* 获取当前主字体 */
+lcd_font_t *lcd_get_font(void) {
+    /* 返回的句柄持有一个引用，切换字体后原来的字体不会被卸载，可以再切换回来 */
+    if (chain_count == 0) return NULL;
+    faces[chain[0]].refs++;
+    return &faces[chain[0]];
+}
+
+/* 追加后备字体 */
+int lcd_add_fallback(lcd_font_t *face) {
+    /*
+    * 功能：在字体链末尾追加一个后备字体，主字体中没有的字符依次在后备字体中查找。
+    * 逻辑：后备字体在第一次查找到它时才解析；字体链持有它的一个引用。
+    *      已缓存的字形以字体序号区分，只有字符串缓存需要随后备字体的变化区分。
+    */
+    if (!lcd || !face || !face->path || chain_count >= FONT_MAX) return -1;
+    if (chain_find(face) >= 0) return 0;
+    face->refs++;
+    chain[chain_count++] = (int)(face - faces);
+    fallback_serial++;
+    return 0;
+}
+
+/* 初始化字库 */ 
+int lcd_init(const char *lcd_path, const char *font_path) {
+
+    /* 释放现有资源（如果有） */ 
+    lcd_cleanup();
+
+    /* 初始化 LCD 设备 */ 
+    lcd = init_lcd_device(lcd_path, 1024, 600);  /* 假设屏幕分辨率为 1024x600 */
+    if (!lcd) {
+        return -1;
+    }
+
+    /* 登记并选用主字体，字体链持有它的引用 */
+    lcd_font_t *face = lcd_font_load(font_path, 0);
+    if (lcd_set_font(face) != 0) {
         lcd_cleanup();
         return -1;
     }
+    lcd_font_release(face);
+
+    /* 屏幕表面指向 LCD 映射内存，默认绘制到屏幕 */
+    screen.width = lcd->width;
+    screen.height = lcd->height;
+    screen.stride = lcd->width;
+    screen.pixels = lcd->mp;
+    target = &screen;
 
     return 0;
 }
 
 /* 清理资源，防内存泄漏 */ 
 void lcd_cleanup(void) {
-    if (font_buffer) {          /* 检查 font_buffer 指针是否不为 NULL */
-        free(font_buffer);
-        font_buffer = NULL;     /* 避免成为悬空指针 */
+    font_swap_cancel();         /* 等待后台加载结束，释放已换下的字体 */
+    font_caches_clear();        /* 字形、字符串缓存与数字精灵依赖当前字体，一并释放 */
+    page_cache_clear();         /* 缓存的页面依赖当前屏幕 */
+    for (int i = 0; i < FONT_MAX; i++) {      /* 释放全部已登记的字体，句柄随之失效 */
+        if (faces[i].path) face_free(&faces[i]);
     }
+    chain_count = 0;
+    font = NULL;
     if (lcd) {                  /* 检查 lcd 指针是否不为 NULL */
         free_lcd_device(lcd);
         lcd = NULL;             /* 避免成为悬空指针 */
     }
+    screen.width = screen.height = screen.stride = 0;   /* 屏幕表面失效，绘制到屏幕不再产生写入 */
+    screen.pixels = NULL;
+    target = &screen;
+}
+
+/* 按路径追加后备字体 */
+int lcd_add_fallback_font(const char *font_path) {
+    /*
+    * 功能：登记字体文件中的第一个字体并追加到字体链末尾，等同于 lcd_font_load + lcd_add_fallback + lcd_font_release。
+    * 逻辑：字体仍在第一次查找到它时解析，这里只检查文件是否可读。
+    */
+    if (!lcd || !font_path) return -1;
+    if (access(font_path, R_OK) != 0) {
+        perror("无法打开字体文件.");
+        return -1;
+    }
+    lcd_font_t *face = lcd_font_load(font_path, 0);
+    int ret = lcd_add_fallback(face);
+    lcd_font_release(face);
+    return ret;
+}
+
+/* 返回 RGB565 表面第 y 行的首地址 */
+static inline uint16_t *surface_row16(const lcd_surface_t *surface, int y) {
+    return (uint16_t*)surface->pixels + (size_t)y * surface->stride;
+}
+
+/* 返回 A8 表面第 y 行的首地址 */
+static inline uint8_t *surface_row8(const lcd_surface_t *surface, int y) {
+    return (uint8_t*)surface->pixels + (size_t)y * surface->stride;
+}
+
+/* RGB565 颜色转换为 0~255 的灰度（A8 表面的取值） */
+static inline uint8_t color_to_gray(color_t color) {
+    unsigned int r = (color >> 11) << 3;
+    unsigned int g = ((color >> 5) & 0x3F) << 2;
+    unsigned int b = (color & 0x1F) << 3;
+    return (uint8_t)((r * 77 + g * 150 + b * 29) >> 8);
+}
+
+/*
+* 填充一段水平像素
+* surface：目标表面。x、y：起点坐标。n：像素数量。调用者保证该段完全位于表面内。
+* RGB565 表面写入颜色，A8 表面写入颜色的灰度。
+*/
+static void surface_fill_span(lcd_surface_t *surface, int x, int y, int n, color_t color) {
+    if (surface->format == LCD_FORMAT_A8) {
+        memset(surface_row8(surface, y) + x, color_to_gray(color), n);
+    } else {
+        uint16_t *dst = surface_row16(surface, y) + x;
+        for (int i = 0; i < n; i++) {
+            dst[i] = color;
+        }
+    }
+}
+
+/*
+* 裁剪矩形栈
+* 栈顶为当前裁剪矩形（右、下边界不含），每次压栈都与原栈顶求交，因此裁剪只会逐层收窄。
+* 所有绘制先把自身的包围盒与“当前裁剪矩形 ∩ 绘制目标”求交一次，之后的内层循环不再做边界判断。
+*/
+#define CLIP_STACK_DEPTH    16      /* 裁剪栈最大深度 */
+
+typedef struct {
+    int x0, y0, x1, y1;
+} ClipRect;
+
+static ClipRect clip_stack[CLIP_STACK_DEPTH] = { { INT_MIN, INT_MIN, INT_MAX, INT_MAX } };
+static int clip_top = 0;    /* 栈顶下标，0 为不限制的初始项 */
+
+/* 压入裁剪矩形，成功返回 0，栈满返回 -1 */
+int lcd_push_clip(int x, int y, int width, int height) {
+    if (clip_top + 1 >= CLIP_STACK_DEPTH) return -1;
+
+    const ClipRect *cur = &clip_stack[clip_top];
+    ClipRect *next = &clip_stack[++clip_top];
+    next->x0 = x > cur->x0 ? x : cur->x0;
+    next->y0 = y > cur->y0 ? y : cur->y0;
+    next->x1 = x + width < cur->x1 ? x + width : cur->x1;
+    next->y1 = y + height < cur->y1 ? y + height : cur->y1;
+    return 0;
+}
+
+/* 弹出裁剪矩形，恢复上一层裁剪 */
+void lcd_pop_clip(void) {
+    if (clip_top > 0) clip_top--;
+}
+
+/*
+* 暂停裁剪
+* 在栈顶之上放入一个不限制的裁剪项并返回原栈顶，绘制到其他表面（如页面缓存、表面间复制）时
+* 不受调用者裁剪矩形的影响；其间压入的裁剪矩形不会覆盖原有的栈内容。用 clip_resume 恢复。
+*/
+static int clip_suspend(void) {
+    int saved = clip_top;
+    if (clip_top + 1 < CLIP_STACK_DEPTH) {
+        ClipRect *open = &clip_stack[++clip_top];
+        open->x0 = open->y0 = INT_MIN;
+        open->x1 = open->y1 = INT_MAX;
+    }
+    return saved;
+}
+
+/* 恢复 clip_suspend 之前的裁剪 */
+static void clip_resume(int saved) {
+    clip_top = saved;
+}
+
+/*
+* 求可绘制区域
+* 把矩形 [*x0, *x1) x [*y0, *y1) 与当前裁剪矩形及绘制目标范围求交，交集为空时返回 0。
+*/
+static int clip_to_target(int *x0, int *y0, int *x1, int *y1) {
+    const ClipRect *clip = &clip_stack[clip_top];
+    if (*x0 < clip->x0) *x0 = clip->x0;
+    if (*y0 < clip->y0) *y0 = clip->y0;
+    if (*x1 > clip->x1) *x1 = clip->x1;
+    if (*y1 > clip->y1) *y1 = clip->y1;
+    if (*x0 < 0) *x0 = 0;
+    if (*y0 < 0) *y0 = 0;
+    if (*x1 > target->width) *x1 = target->width;
+    if (*y1 > target->height) *y1 = target->height;
+    return *x0 < *x1 && *y0 < *y1;
+}
+
+/* 填充矩形 [x0, x1) x [y0, y1)，裁剪一次后逐行填充 */
+static void fill_rect(int x0, int y0, int x1, int y1, color_t color) {
+    if (!clip_to_target(&x0, &y0, &x1, &y1)) return;
+    for (int j = y0; j < y1; j++) {
+        surface_fill_span(target, x0, j, x1 - x0, color);
+    }
 }
 
 /* 清空屏幕 */ 
 void lcd_clear(color_t color) {     
     if (!lcd) return;   /* LCD 未初始化，返回 */
     
-    for (int i = 0; i < lcd->width * lcd->height; i++) {
-        lcd->mp[i] = color;  /* 将整个 LCD 屏幕填充为指定颜色 */
-    }
+    /* 将整个绘制目标（当前裁剪范围内）逐行填充为指定颜色 */
+    fill_rect(0, 0, target->width, target->height, color);
 }
 
 /* 设置字体大小 */ 
@@ -193,9 +866,97 @@ void lcd_set_font_size(int size) {
 /* 绘制像素点 */ 
 void lcd_draw_pixel(int x, int y, color_t color) {
     if (!lcd) return;
-    if (x >= 0 && x < lcd->width && y >= 0 && y < lcd->height) {
-        lcd->mp[y * lcd->width + x] = color;
+    const ClipRect *clip = &clip_stack[clip_top];
+    if (x >= 0 && x < target->width && y >= 0 && y < target->height &&
+        x >= clip->x0 && x < clip->x1 && y >= clip->y0 && y < clip->y1) {
+        if (target->format == LCD_FORMAT_A8) {
+            surface_row8(target, y)[x] = color_to_gray(color);
+        } else {
+            surface_row16(target, y)[x] = color;
+        }
+    }
+}
+
+/* 绘制水平线，包含两个端点 */
+static void draw_hline(int x1, int x2, int y, color_t color) {
+    if (x1 > x2) { int t = x1; x1 = x2; x2 = t; }
+    fill_rect(x1, y, x2 + 1, y + 1, color);     /* 一行填充 */
+}
+
+/* 绘制垂直线，包含两个端点 */
+static void draw_vline(int x, int y1, int y2, color_t color) {
+    if (y1 > y2) { int t = y1; y1 = y2; y2 = t; }
+    int x0 = x, x1 = x + 1, y0 = y1, y_end = y2 + 1;
+    if (!clip_to_target(&x0, &y0, &x1, &y_end)) return;
+
+    /* 裁剪一次后按行跨度逐个写入同一列 */
+    if (target->format == LCD_FORMAT_A8) {
+        uint8_t gray = color_to_gray(color);
+        uint8_t *p = surface_row8(target, y0) + x;
+        for (int j = y0; j < y_end; j++, p += target->stride) *p = gray;
+    } else {
+        uint16_t *p = surface_row16(target, y0) + x;
+        for (int j = y0; j < y_end; j++, p += target->stride) *p = color;
+    }
+}
+
+/* Cohen–Sutherland 区域码 */
+#define OUT_LEFT    1
+#define OUT_RIGHT   2
+#define OUT_TOP     4
+#define OUT_BOTTOM  8
+
+static int outcode(int x, int y, int xmin, int ymin, int xmax, int ymax) {
+    int code = 0;
+    if (x < xmin) code |= OUT_LEFT; else if (x > xmax) code |= OUT_RIGHT;
+    if (y < ymin) code |= OUT_TOP; else if (y > ymax) code |= OUT_BOTTOM;
+    return code;
+}
+
+/* 整数除法四舍五入（分母为正） */
+static long long div_round(long long num, long long den) {
+    return num >= 0 ? (num + den / 2) / den : -((-num + den / 2) / den);
+}
+
+/*
+* Cohen–Sutherland 直线裁剪
+* 把线段裁剪到 [xmin, xmax] x [ymin, ymax]（含边界）内，交点四舍五入到整数像素。
+* 每次把一个外部端点移到它越过的边界上，最多移动 4 次（每条边一次）。
+* 线段完全在区域外时返回 0。
+*/
+static int clip_line(int *x1, int *y1, int *x2, int *y2, int xmin, int ymin, int xmax, int ymax) {
+    int code1 = outcode(*x1, *y1, xmin, ymin, xmax, ymax);
+    int code2 = outcode(*x2, *y2, xmin, ymin, xmax, ymax);
+
+    for (int n = 0; code1 | code2; n++) {
+        if ((code1 & code2) || n >= 4) return 0;    /* 两端在同一侧外部，整条线不可见 */
+
+        int code = code1 ? code1 : code2;
+        long long ax = *x1, ay = *y1, bx = *x2, by = *y2;
+        long long x, y;
+        if (code & OUT_TOP) {
+            y = ymin;
+            x = ax + div_round((bx - ax) * (y - ay), by - ay);
+        } else if (code & OUT_BOTTOM) {
+            y = ymax;
+            x = ax + div_round((bx - ax) * (y - ay), by - ay);
+        } else if (code & OUT_LEFT) {
+            x = xmin;
+            y = ay + div_round((by - ay) * (x - ax), bx - ax);
+        } else {
+            x = xmax;
+            y = ay + div_round((by - ay) * (x - ax), bx - ax);
+        }
+
+        if (code == code1) {
+            *x1 = (int)x; *y1 = (int)y;
+            code1 = outcode(*x1, *y1, xmin, ymin, xmax, ymax);
+        } else {
+            *x2 = (int)x; *y2 = (int)y;
+            code2 = outcode(*x2, *y2, xmin, ymin, xmax, ymax);
+        }
     }
+    return 1;
 }
 
 /* 绘制直线（Bresenham算法） */ 
@@ -205,18 +966,38 @@ void lcd_draw_line(int x1, int y1, int x2, int y2, color_t color) {
     /* 
     * 功能：在两点 (x1, y1) 和 (x2, y2) 之间绘制一条直线。
     * 参数：x1、y1：直线起点坐标。x2、y2：直线终点坐标。color：直线颜色。
-    * 逻辑：先计算两点间的水平和垂直距离 dx、dy，以及 x、y 方向的步进值 sx、sy。
-    *      接着使用 err 变量来决定下一个像素点的位置，在循环中不断调用
-    *      lcd_draw_pixel 绘制像素点，直到到达终点。 
+    * 逻辑：水平线与垂直线分别走整行填充和按行跨度写列的快速路径。
+    *      其他直线先用 Cohen–Sutherland 算法裁剪到可绘制区域内，再计算两点间的水平和垂直
+    *      距离 dx、dy，以及 x、y 方向的步进值 sx、sy，使用 err 变量决定下一个像素点的位置，
+    *      直到到达终点。裁剪后的每个像素都在区域内，循环中不再做边界判断。
     */
+    if (y1 == y2) {
+        draw_hline(x1, x2, y1, color);
+        return;
+    }
+    if (x1 == x2) {
+        draw_vline(x1, y1, y2, color);
+        return;
+    }
+
+    int xmin = INT_MIN, ymin = INT_MIN, xmax = INT_MAX, ymax = INT_MAX;
+    if (!clip_to_target(&xmin, &ymin, &xmax, &ymax)) return;
+    if (!clip_line(&x1, &y1, &x2, &y2, xmin, ymin, xmax - 1, ymax - 1)) return;
+
     int dx = abs(x2 - x1);
     int dy = abs(y2 - y1);
     int sx = x1 < x2 ? 1 : -1;
     int sy = y1 < y2 ? 1 : -1;
     int err = dx - dy;
+    int a8 = target->format == LCD_FORMAT_A8;
+    uint8_t gray = color_to_gray(color);
     
     while (1) {
-        lcd_draw_pixel(x1, y1, color);
+        if (a8) {
+            surface_row8(target, y1)[x1] = gray;
+        } else {
+            surface_row16(target, y1)[x1] = color;
+        }
         
         if (x1 == x2 && y1 == y2) break;
         
@@ -239,14 +1020,14 @@ void lcd_draw_rectangle(int x, int y, int width, int height, color_t color) {
     /* 
     * 功能：绘制一个空心矩形。
     * 参数：x、y：矩形左上角坐标。width、height：矩形的宽度和高度。color：矩形边框颜色。
-    * 逻辑：调用 lcd_draw_line 函数分别绘制矩形的四条边。
+    * 逻辑：上下两边用水平线、左右两边用垂直线绘制。
     */
 
     /* 绘制四条边 */ 
-    lcd_draw_line(x, y, x + width - 1, y, color);                               /* 上边 */ 
-    lcd_draw_line(x, y + height - 1, x + width - 1, y + height - 1, color);     /* 下边 */
-    lcd_draw_line(x, y, x, y + height - 1, color);                              /* 左边 */
-    lcd_draw_line(x + width - 1, y, x + width - 1, y + height - 1, color);      /* 右边 */
+    draw_hline(x, x + width - 1, y, color);                     /* 上边 */ 
+    draw_hline(x, x + width - 1, y + height - 1, color);        /* 下边 */
+    draw_vline(x, y, y + height - 1, color);                    /* 左边 */
+    draw_vline(x + width - 1, y, y + height - 1, color);        /* 右边 */
 }
 
 /* 绘制填充矩形 */ 
@@ -256,16 +1037,9 @@ void lcd_draw_filled_rectangle(int x, int y, int width, int height, color_t colo
     /* 
     * 功能：绘制一个填充矩形。
     * 参数：x、y：矩形左上角坐标。width、height：矩形的宽度和高度。color：矩形填充颜色。
-    * 逻辑：使用两层循环遍历矩形区域内的所有像素点，检查坐标是否在屏幕范围内，
-    *      若在则直接操作屏幕缓冲区设置像素颜色。
+    * 逻辑：先将矩形与当前裁剪矩形及绘制目标的范围求交，再逐行填充交集内的像素。
     */
-    for (int j = y; j < y + height; j++) {
-        for (int i = x; i < x + width; i++) {
-            if (i >= 0 && i < lcd->width && j >= 0 && j < lcd->height) {
-                lcd->mp[j * lcd->width + i] = color;
-            }
-        }
-    }
+    fill_rect(x, y, x + width, y + height, color);
 }
 
 /* 绘制圆角矩形 */ 
@@ -275,7 +1049,7 @@ void lcd_draw_rounded_rectangle(int x, int y, int width, int height, int radius,
     /* 
     * 功能：绘制一个空心圆角矩形。
     * 参数：x、y：矩形左上角坐标。width、height：矩形的宽度和高度。radius：圆角半径。color：矩形边框颜色。
-    * 逻辑：先确保圆角半径不超过矩形宽度或高度的一半。接着调用 lcd_draw_line 绘制四条边，
+    * 逻辑：先确保圆角半径不超过矩形宽度或高度的一半。接着用水平线和垂直线绘制四条边，
     *      再通过两层循环和圆的方程判断像素点是否在圆弧边缘，若在则调用 lcd_draw_pixel 
     *      绘制四个角的圆弧。
     */
@@ -285,10 +1059,10 @@ void lcd_draw_rounded_rectangle(int x, int y, int width, int height, int radius,
     if (radius > height/2) radius = height/2;
     
     /* 绘制四条边 */ 
-    lcd_draw_line(x + radius, y, x + width - radius, y, color);                             /* 上边 */ 
-    lcd_draw_line(x + radius, y + height - 1, x + width - radius, y + height - 1, color);   /* 下边 */ 
-    lcd_draw_line(x, y + radius, x, y + height - radius, color);                            /* 左边 */ 
-    lcd_draw_line(x + width - 1, y + radius, x + width - 1, y + height - radius, color);    /* 右边 */ 
+    draw_hline(x + radius, x + width - radius, y, color);                       /* 上边 */ 
+    draw_hline(x + radius, x + width - radius, y + height - 1, color);          /* 下边 */ 
+    draw_vline(x, y + radius, y + height - radius, color);                      /* 左边 */ 
+    draw_vline(x + width - 1, y + radius, y + height - radius, color);          /* 右边 */ 
     
     /* 绘制四个角的圆弧 */ 
     for (int i = 0; i <= radius; i++) {
@@ -319,108 +1093,118 @@ void lcd_draw_filled_rounded_rectangle(int x, int y, int width, int height, int
     /* 
     * 功能：绘制一个填充圆角矩形。
     * 参数：x、y：矩形左上角坐标。width、height：矩形的宽度和高度。radius：圆角半径。color：矩形填充颜色。
-    * 逻辑：先确保圆角半径不超过矩形宽度或高度的一半。接着调用 lcd_draw_filled_rectangle 绘制中间的矩形
-    *      部分，再通过两层循环和圆的方程判断像素点是否在圆角范围内，若在则调用 lcd_draw_pixel 填充四个角。
+    * 逻辑：先确保圆角半径不超过矩形宽度或高度的一半。中间 height - 2*radius 行是完整的矩形；
+    *      上下各 radius 行按圆的方程求出每行圆弧的水平范围，作为一段水平线填充。
+    *      第 j 行（自圆心向外数，0 <= j < radius）向左右各延伸 i_max + 1 个像素，
+    *      i_max 是满足 i*i + j*j <= radius*radius 的最大 i（不超过 radius - 1）。
     */
 
     /* 确保半径不超过宽度或高度的一半 */ 
     if (radius > width/2) radius = width/2;
     if (radius > height/2) radius = height/2;
+    if (radius < 0) radius = 0;
     
     /* 绘制中间矩形部分 */ 
-    lcd_draw_filled_rectangle(x, y + radius, width, height - 2*radius, color);
-    lcd_draw_filled_rectangle(x + radius, y, width - 2*radius, height, color);
+    fill_rect(x, y + radius, x + width, y + height - radius, color);
     
-    /* 绘制四个角的圆弧 */ 
-    for (int i = 0; i < radius; i++) {
-        for (int j = 0; j < radius; j++) {
-            if (i*i + j*j <= radius*radius) {
-                /* 左上角填充 */ 
-                lcd_draw_pixel(x + radius - i - 1, y + radius - j - 1, color);
-                lcd_draw_pixel(x + radius - i, y + radius - j - 1, color);
-                lcd_draw_pixel(x + radius - i - 1, y + radius - j, color);
-                
-                /* 右上角填充 */ 
-                lcd_draw_pixel(x + width - radius + i, y + radius - j - 1, color);
-                lcd_draw_pixel(x + width - radius + i - 1, y + radius - j - 1, color);
-                lcd_draw_pixel(x + width - radius + i, y + radius - j, color);
-                
-                /* 左下角填充 */ 
-                lcd_draw_pixel(x + radius - i - 1, y + height - radius + j, color);
-                lcd_draw_pixel(x + radius - i, y + height - radius + j, color);
-                lcd_draw_pixel(x + radius - i - 1, y + height - radius + j - 1, color);
-                
-                /* 右下角填充 */ 
-                lcd_draw_pixel(x + width - radius + i, y + height - radius + j, color);
-                lcd_draw_pixel(x + width - radius + i - 1, y + height - radius + j, color);
-                lcd_draw_pixel(x + width - radius + i, y + height - radius + j - 1, color);
-            }
-        }
+    /* 逐行绘制上下两端的圆角部分 */ 
+    for (int j = 0; j < radius; j++) {
+        int i_max = (int)sqrt((double)(radius * radius - j * j));
+        if (i_max > radius - 1) i_max = radius - 1;
+        int left = x + radius - i_max - 1;
+        int right = x + width - radius + i_max + 1;
+        fill_rect(left, y + radius - j - 1, right, y + radius - j, color);             /* 上端 */
+        fill_rect(left, y + height - radius + j, right, y + height - radius + j + 1, color);  /* 下端 */
     }
 }
 
-/* 计算文本宽度 */ 
-int lcd_get_text_width(const char *text) {
-    if (!text || !lcd) return 0;
-    
+/* 计算输入源的文本宽度 */
+static int text_width(TextSource *src) {
     /* 
     * 计算缩放比例
     * 调用 stbtt_ScaleForPixelHeight 函数，根据当前字体和字体大小计算缩放比例 scale
     */
-    float scale = stbtt_ScaleForPixelHeight(&font, font_size);
+    float scale = stbtt_ScaleForPixelHeight(font, font_size);
     float xpos = 0;             /* 累加文本的总宽度 */
-    int i = 0;                  /* 字符串的索引 */
-    int len = strlen(text);     /* 字符串的长度 */
+
+    /* 输入源每个字符只解码一次：本轮的下一个字符即下一轮的当前字符 */
+    int key, next_key = 0;
+    int more = text_next(src, &key);
     
     /* 遍历文本 */
-    while (i < len) {
-        int codepoint;  /* decode_utf8 函数将 UTF-8 字符解码为 Unicode 码点 codepoint */
-        int char_len = decode_utf8(&text[i], &codepoint);   /* 字符的字节长度 */
-        
-        /*
-        * 调用 stbtt_GetCodepointHMetrics 函数获取当前字符的水平度量信息，
-        * 包括字符的前进宽度 advance 和左部空白 lsb，将 advance * scale 累加到 xpos。
-        */
-        int advance, lsb;
-        stbtt_GetCodepointHMetrics(&font, codepoint, &advance, &lsb);
-        xpos += (advance * scale);
+    while (more) {
+        /* 获取当前字符的前进宽度 advance，将 advance * scale 累加到 xpos */
+        xpos += key_advance(key) * scale;
         
         /*
-        * 若不是最后一个字符，解码下一个字符的码点 next_codepoint，
-        * 调用 stbtt_GetCodepointKernAdvance 函数获取当前字符
+        * 若不是最后一个字符，取出下一个字符 next_key，获取当前字符
         * 和下一个字符之间的字距调整值，将其乘以 scale 后累加到 xpos。
-        * i 增加 char_len，处理下一个字符。
+        * 下一个字符成为当前字符，继续处理。
         */
-        if (i + char_len < len) {
-            int next_codepoint;
-            decode_utf8(&text[i + char_len], &next_codepoint);
-            xpos += scale * stbtt_GetCodepointKernAdvance(&font, codepoint, next_codepoint);
+        more = text_next(src, &next_key);
+        if (more) {
+            xpos += scale * key_kern(key, next_key);
         }
-        
-        i += char_len;
+        key = next_key;
     }
     
     return (int)ceil(xpos);     /* 使用 ceil 函数向上取整 xpos，并将其转换为整数后返回 */
 }
 
-/* 计算文本高度 */ 
-int lcd_get_text_height(void) {
-    if (!lcd) return 0;
-    
-    /*
-    * 计算缩放比例
-    * 调用 stbtt_ScaleForPixelHeight 函数，根据当前字体和字体大小计算缩放比例 scale。
-    * 包括字符的前进宽度 advance 和左部空白 lsb，将 advance * scale 累加到 xpos。
-    */
-    float scale = stbtt_ScaleForPixelHeight(&font, font_size);
-
-    /*
-    * 获取字体垂直度量信息
+/* 计算文本宽度 */ 
+int lcd_get_text_width(const char *text) {
+    if (!text || !lcd) return 0;
+    return lcd_get_text_width_n(text, strlen(text));
+}
+
+/* 计算长度为 len 字节的文本宽度 */
+int lcd_get_text_width_n(const char *text, int len) {
+    if (!text || !lcd) return 0;
+    TextSource src;
+    text_source_init(&src, TEXT_UTF8, text, len);
+    return text_width(&src);
+}
+
+/* 计算码点数组的文本宽度 */
+int lcd_get_text_width_u32(const uint32_t *codepoints, int count) {
+    if (!codepoints || !lcd) return 0;
+    TextSource src;
+    text_source_init(&src, TEXT_UTF32, codepoints, count);
+    return text_width(&src);
+}
+
+/* 计算字形索引数组的宽度 */
+int lcd_get_glyphs_width(const uint16_t *glyphs, int count) {
+    if (!glyphs || !lcd) return 0;
+    TextSource src;
+    text_source_init(&src, TEXT_GLYPH, glyphs, count);
+    return text_width(&src);
+}
+
+/* 查找码点对应的字形索引 */
+int lcd_glyph_index(int codepoint) {
+    if (!lcd) return 0;
+    return stbtt_FindGlyphIndex(font, codepoint);
+}
+
+/* 计算文本高度 */ 
+int lcd_get_text_height(void) {
+    if (!lcd) return 0;
+    
+    /*
+    * 计算缩放比例
+    * 调用 stbtt_ScaleForPixelHeight 函数，根据当前字体和字体大小计算缩放比例 scale。
+    * 包括字符的前进宽度 advance 和左部空白 lsb，将 advance * scale 累加到 xpos。
+    */
+    float scale = stbtt_ScaleForPixelHeight(font, font_size);
+
+    /*
+    * 获取字体垂直度量信息
     * 调用 stbtt_GetFontVMetrics 函数获取字体的垂直度量信息，包括基线以上的高度 ascent 
     * 和基线以下的深度 descent。
     */
     int ascent, descent;
-    stbtt_GetFontVMetrics(&font, &ascent, &descent, 0);
+    stbtt_GetFontVMetrics(font, &ascent, &descent, 0);
 
     /*
     * 计算 (ascent - descent) * scale，
@@ -429,138 +1213,4152 @@ int lcd_get_text_height(void) {
     return (int)((ascent - descent) * scale);   
 }
 
-/* 渲染文字 */
-void lcd_render_text(const char *text, int x, int y, color_t text_color, int font_size) {
-    if (!text || !lcd) return;
-    
-    /* 边界检查与初始化 */
-    float scale = stbtt_ScaleForPixelHeight(&font, font_size);  /* 根据当前字体和字体大小计算缩放比例 */
-    int ascent, baseline;
-    stbtt_GetFontVMetrics(&font, &ascent, 0, 0);    /* 获取字体的垂直度量信息，ascent 表示基线以上的高度 */
-    baseline = (int)(ascent * scale);   /* 计算基线相对于起始 y 坐标的位置 */
+/*
+* RGB565 像素 alpha 混合
+* bg：背景像素颜色。fg：前景（文字）颜色。alpha：前景覆盖度，0~255。
+* 三个颜色分量在各自的位域内独立插值，不需要拆分为 8 位分量；插值结果的低位余数
+* 会落到相邻分量的位域中，必须再按位域屏蔽。
+*/
+static inline uint16_t blend_rgb565(uint16_t bg, uint16_t fg, unsigned int alpha) {
+    uint16_t r = (((bg & 0xF800) * (255 - alpha) + (fg & 0xF800) * alpha) / 255) & 0xF800;
+    uint16_t g = (((bg & 0x07E0) * (255 - alpha) + (fg & 0x07E0) * alpha) / 255) & 0x07E0;
+    uint16_t b = ((bg & 0x001F) * (255 - alpha) + (fg & 0x001F) * alpha) / 255;
+    return r | g | b;
+}
 
-    float xpos = (float)x;      /* 初始化当前字符的 x 坐标 */
-    int len = strlen(text);     /* 获取文本字符串的长度 */
-    int i = 0;
-    
-    /* 遍历文本 */
-    while (i < len) {
-        int codepoint;
+/* A8 像素 alpha 混合，gray 为前景灰度 */
+static inline uint8_t blend_gray(uint8_t bg, unsigned int gray, unsigned int alpha) {
+    return (uint8_t)((bg * (255 - alpha) + gray * alpha) / 255);
+}
+
+/*
+* 覆盖度蒙版混合
+* coverage：8 位覆盖度蒙版，每行 width 字节。dst_x、dst_y：蒙版左上角在绘制目标上的坐标。
+* color：前景颜色。clip_x0、clip_y0、clip_x1、clip_y1：裁剪矩形（右、下边界不含）。
+* 逻辑：裁剪矩形先与当前裁剪矩形及绘制目标求交，再与蒙版区域求交，只遍历交集内的像素，
+*      内层循环不做逐像素的边界判断；完全覆盖的像素直接写入前景色。
+*      A8 目标按颜色灰度做同样的插值。
+*/
+static void blend_coverage(const unsigned char *coverage, int width, int height, int dst_x, int dst_y,
+                           color_t color, int clip_x0, int clip_y0, int clip_x1, int clip_y1) {
+    /* 裁剪矩形再与当前裁剪矩形及绘制目标求交 */
+    if (!clip_to_target(&clip_x0, &clip_y0, &clip_x1, &clip_y1)) return;
+
+    /* 与裁剪矩形求交，得到蒙版内需要处理的行列范围 [i0, i1) x [j0, j1) */
+    int i0 = clip_x0 > dst_x ? clip_x0 - dst_x : 0;
+    int j0 = clip_y0 > dst_y ? clip_y0 - dst_y : 0;
+    int i1 = clip_x1 < dst_x + width ? clip_x1 - dst_x : width;
+    int j1 = clip_y1 < dst_y + height ? clip_y1 - dst_y : height;
+    if (i0 >= i1 || j0 >= j1) return;
+
+    if (target->format == LCD_FORMAT_A8) {
+        unsigned int gray = color_to_gray(color);
+        for (int j = j0; j < j1; ++j) {
+            const unsigned char *src = coverage + j * width;
+            uint8_t *dst = surface_row8(target, dst_y + j) + dst_x;
+            for (int i = i0; i < i1; ++i) {
+                unsigned int alpha = src[i];
+                if (alpha > 0) {
+                    dst[i] = blend_gray(dst[i], gray, alpha);
+                }
+            }
+        }
+        return;
+    }
+
+    for (int j = j0; j < j1; ++j) {
+        const unsigned char *src = coverage + j * width;
+        uint16_t *dst = surface_row16(target, dst_y + j) + dst_x;
+        for (int i = i0; i < i1; ++i) {
+            unsigned char alpha = src[i];   /* 该像素的透明度，为 0 时保持背景不变 */
+            if (alpha == 255) {
+                dst[i] = color;
+            } else if (alpha > 0) {
+                dst[i] = blend_rgb565(dst[i], color, alpha);
+            }
+        }
+    }
+}
+
+/* 4 位覆盖度还原为 8 位（0～15 映射到 0～255） */
+static inline unsigned int nibble_alpha(const unsigned char *packed, int i) {
+    return ((packed[i >> 1] >> ((i & 1) << 2)) & 15) * 17;
+}
+
+/*
+* 4 位覆盖度蒙版混合
+* packed：每像素 4 位的覆盖度，每字节两个像素（低 4 位在前），每行 (width + 1) / 2 字节。
+* 逻辑：与 blend_coverage 相同，在内层循环中直接取出 4 位覆盖度，不需要先解压到临时缓冲区。
+*/
+static void blend_coverage_a4(const unsigned char *packed, int width, int height, int dst_x, int dst_y,
+                              color_t color, int clip_x0, int clip_y0, int clip_x1, int clip_y1) {
+    if (!clip_to_target(&clip_x0, &clip_y0, &clip_x1, &clip_y1)) return;
+    int i0 = clip_x0 > dst_x ? clip_x0 - dst_x : 0;
+    int j0 = clip_y0 > dst_y ? clip_y0 - dst_y : 0;
+    int i1 = clip_x1 < dst_x + width ? clip_x1 - dst_x : width;
+    int j1 = clip_y1 < dst_y + height ? clip_y1 - dst_y : height;
+    if (i0 >= i1 || j0 >= j1) return;
+
+    int pitch = (width + 1) >> 1;
+    if (target->format == LCD_FORMAT_A8) {
+        unsigned int gray = color_to_gray(color);
+        for (int j = j0; j < j1; ++j) {
+            const unsigned char *src = packed + j * pitch;
+            uint8_t *dst = surface_row8(target, dst_y + j) + dst_x;
+            for (int i = i0; i < i1; ++i) {
+                unsigned int alpha = nibble_alpha(src, i);
+                if (alpha > 0) dst[i] = blend_gray(dst[i], gray, alpha);
+            }
+        }
+        return;
+    }
+
+    for (int j = j0; j < j1; ++j) {
+        const unsigned char *src = packed + j * pitch;
+        uint16_t *dst = surface_row16(target, dst_y + j) + dst_x;
+        for (int i = i0; i < i1; ++i) {
+            unsigned int alpha = nibble_alpha(src, i);
+            if (alpha == 255) {
+                dst[i] = color;
+            } else if (alpha > 0) {
+                dst[i] = blend_rgb565(dst[i], color, alpha);
+            }
+        }
+    }
+}
+
+/*
+* 游程编码覆盖度蒙版格式
+* 每行由若干记号组成，记号不跨行。记号首字节的高两位表示类型，其余位为像素数减 1：
+*   00nnnnnn：n + 1 个完全透明的像素（最多 64 个）。
+*   01nnnnnn：n + 1 个完全覆盖的像素（最多 64 个）。
+*   1nnnnnnn：n + 1 个像素的 4 位覆盖度，紧跟 (n + 2) / 2 字节，格式同 blend_coverage_a4。
+*/
+#define RLE_EMPTY   0x00        /* 透明游程 */
+#define RLE_FULL    0x40        /* 完全覆盖游程 */
+#define RLE_LITERAL 0x80        /* 4 位覆盖度直接存储 */
+
+/*
+* 游程编码覆盖度蒙版混合
+* 逻辑：逐个记号解码，透明游程直接跳过，完全覆盖游程整段写入前景色（A8 目标写入灰度），
+*      只有直接存储的像素才逐个混合。裁剪矩形以上的行只解析记号长度；每个记号与 [i0, i1) 求交后处理。
+*/
+static void blend_coverage_rle(const unsigned char *data, int width, int height, int dst_x, int dst_y,
+                               color_t color, int clip_x0, int clip_y0, int clip_x1, int clip_y1) {
+    if (!clip_to_target(&clip_x0, &clip_y0, &clip_x1, &clip_y1)) return;
+    int i0 = clip_x0 > dst_x ? clip_x0 - dst_x : 0;
+    int j0 = clip_y0 > dst_y ? clip_y0 - dst_y : 0;
+    int i1 = clip_x1 < dst_x + width ? clip_x1 - dst_x : width;
+    int j1 = clip_y1 < dst_y + height ? clip_y1 - dst_y : height;
+    if (i0 >= i1 || j0 >= j1) return;
+
+    int gray_target = target->format == LCD_FORMAT_A8;
+    unsigned int gray = color_to_gray(color);
+    const unsigned char *p = data;
+    for (int j = 0; j < j0; ++j) {          /* 裁剪矩形以上的行：只跳过记号，不计算行地址 */
+        for (int i = 0; i < width; ) {
+            unsigned int token = *p++;
+            int n = (token & (token & RLE_LITERAL ? 0x7F : 0x3F)) + 1;
+            if (token & RLE_LITERAL) p += (n + 1) >> 1;
+            i += n;
+        }
+    }
+    for (int j = j0; j < j1; ++j) {
+        uint16_t *dst16 = gray_target ? NULL : surface_row16(target, dst_y + j) + dst_x;
+        uint8_t *dst8 = gray_target ? surface_row8(target, dst_y + j) + dst_x : NULL;
+        for (int i = 0; i < width; ) {
+            unsigned int token = *p++;
+            int n = (token & (token & RLE_LITERAL ? 0x7F : 0x3F)) + 1;
+            const unsigned char *literal = p;
+            if (token & RLE_LITERAL) p += (n + 1) >> 1;
+
+            int a = i > i0 ? i : i0;                /* 记号与 [i0, i1) 的交集 */
+            int b = i + n < i1 ? i + n : i1;
+            if (a < b && (token & (RLE_LITERAL | RLE_FULL))) {
+                if (!(token & RLE_LITERAL)) {
+                    if (gray_target) memset(dst8 + a, gray, b - a);
+                    else for (int k = a; k < b; k++) dst16[k] = color;
+                } else if (gray_target) {
+                    for (int k = a; k < b; k++) {
+                        unsigned int alpha = nibble_alpha(literal, k - i);
+                        if (alpha > 0) dst8[k] = blend_gray(dst8[k], gray, alpha);
+                    }
+                } else {
+                    for (int k = a; k < b; k++) {
+                        unsigned int alpha = nibble_alpha(literal, k - i);
+                        if (alpha == 255) {
+                            dst16[k] = color;
+                        } else if (alpha > 0) {
+                            dst16[k] = blend_rgb565(dst16[k], color, alpha);
+                        }
+                    }
+                }
+            }
+            i += n;
+        }
+    }
+}
+
+/*
+* 单像素覆盖度混合
+* box：已与绘制目标求交的裁剪矩形。坐标在 box 外或覆盖度为 0 时不写入；box 为 NULL 时调用者保证坐标可写，不做检查。
+* 与文字渲染使用同一套 RGB565 / A8 混合运算。
+*/
+static inline void blend_pixel(const ClipRect *box, int x, int y, color_t color, unsigned int alpha) {
+    if (alpha == 0 || (box && (x < box->x0 || x >= box->x1 || y < box->y0 || y >= box->y1))) return;
+    if (target->format == LCD_FORMAT_A8) {
+        uint8_t *dst = surface_row8(target, y) + x;
+        *dst = blend_gray(*dst, color_to_gray(color), alpha);
+    } else {
+        uint16_t *dst = surface_row16(target, y) + x;
+        *dst = alpha >= 255 ? color : blend_rgb565(*dst, color, alpha);
+    }
+}
+
+/* 当前可绘制区域（裁剪矩形 ∩ 绘制目标），为空时返回 0 */
+static int drawable_box(ClipRect *box) {
+    box->x0 = box->y0 = INT_MIN;
+    box->x1 = box->y1 = INT_MAX;
+    return clip_to_target(&box->x0, &box->y0, &box->x1, &box->y1);
+}
+
+/* 浮点数的整数部分、小数部分及其补数（Wu 算法用） */
+static inline float fpart(float v) { return v - (float)floor(v); }
+static inline float rfpart(float v) { return 1.0f - fpart(v); }
+
+/* 按长轴方向绘制 Wu 直线的一个像素对，steep 为 1 时交换 x、y */
+static inline void wu_plot(const ClipRect *box, int steep, int x, int y, color_t color, float coverage) {
+    unsigned int alpha = (unsigned int)(coverage * 255.0f + 0.5f);
+    if (steep) blend_pixel(box, y, x, color, alpha);
+    else blend_pixel(box, x, y, color, alpha);
+}
+
+/*
+* 按长轴方向绘制 Wu 直线中间部分的一个像素对（短轴坐标 y、y + 1）
+* fy：短轴坐标，16.16 定点数，小数部分决定两个像素的覆盖度。box 为 NULL 时不检查坐标。
+*/
+static inline void wu_pair(const ClipRect *box, int steep, int x, int64_t fy, color_t color) {
+    int y = (int)(fy >> 16);
+    unsigned int upper = (unsigned int)(fy >> 8) & 0xFF;
+    if (steep) {
+        blend_pixel(box, y, x, color, 255 - upper);
+        blend_pixel(box, y + 1, x, color, upper);
+    } else {
+        blend_pixel(box, x, y, color, 255 - upper);
+        blend_pixel(box, x, y + 1, color, upper);
+    }
+}
+
+/* 向下、向上取整的整数除法，b > 0 */
+static inline int64_t floor_div64(int64_t a, int64_t b) { return a >= 0 ? a / b : -((-a + b - 1) / b); }
+static inline int64_t ceil_div64(int64_t a, int64_t b) { return -floor_div64(-a, b); }
+
+/*
+* 求 Wu 直线中间部分短轴坐标落在 [ylo, yhi] 内的步数范围
+* 第 k 步的短轴坐标为 (fy + gradient * k) >> 16，k 取 0～n-1；结果写入 [*k0, *k1]，范围为空时 *k0 > *k1。
+*/
+static void wu_range(int64_t fy, int64_t gradient, int n, int ylo, int yhi, int *k0, int *k1) {
+    int64_t a = (int64_t)ylo * 65536 - fy;              /* gradient * k >= a */
+    int64_t b = ((int64_t)yhi + 1) * 65536 - fy - 1;    /* gradient * k <= b */
+    int64_t lo = 0, hi = n - 1;
+    if (gradient > 0) {
+        int64_t l = ceil_div64(a, gradient), h = floor_div64(b, gradient);
+        if (l > lo) lo = l;
+        if (h < hi) hi = h;
+    } else if (gradient < 0) {
+        int64_t l = ceil_div64(-b, -gradient), h = floor_div64(-a, -gradient);
+        if (l > lo) lo = l;
+        if (h < hi) hi = h;
+    } else if (a > 0 || b < 0) {
+        hi = -1;
+    }
+    if (lo > hi) {
+        *k0 = 0;
+        *k1 = -1;
+        return;
+    }
+    *k0 = (int)lo;
+    *k1 = (int)hi;
+}
+
+/* 绘制抗锯齿直线（Wu 算法） */
+void lcd_draw_line_aa(int x1, int y1, int x2, int y2, color_t color) {
+    if (!lcd) return;
+
+    /*
+    * 功能：在两点之间绘制 1 像素宽的抗锯齿直线。
+    * 逻辑：沿长轴逐列（或逐行）前进，直线在短轴方向落在相邻两个像素之间，
+    *      按与两个像素中心的距离分配覆盖度后与背景混合。长轴方向先与可绘制区域求交，
+    *      短轴坐标用 16.16 定点数步进，再求出像素对至少一个可见、两个都可见的步数范围：
+    *      两个都可见的部分直接写入，不逐像素检查坐标；只有进出短轴边界的少数几步逐像素检查。
+    */
+    ClipRect box;
+    if (!drawable_box(&box)) return;
+
+    float fx1 = (float)x1, fy1 = (float)y1, fx2 = (float)x2, fy2 = (float)y2;
+    int steep = abs(y2 - y1) > abs(x2 - x1);
+    if (steep) {
+        float t;
+        t = fx1; fx1 = fy1; fy1 = t;
+        t = fx2; fx2 = fy2; fy2 = t;
+    }
+    if (fx1 > fx2) {
+        float t;
+        t = fx1; fx1 = fx2; fx2 = t;
+        t = fy1; fy1 = fy2; fy2 = t;
+    }
+    float gradient = (fx2 == fx1) ? 1.0f : (fy2 - fy1) / (fx2 - fx1);
+
+    /* 两个端点各画一个像素对（端点坐标为整数，覆盖度按 0.5 像素的端点间隙计算） */
+    int xs = (int)fx1, xe = (int)fx2;
+    wu_plot(&box, steep, xs, (int)floor(fy1), color, rfpart(fy1) * 0.5f);
+    wu_plot(&box, steep, xs, (int)floor(fy1) + 1, color, fpart(fy1) * 0.5f);
+    wu_plot(&box, steep, xe, (int)floor(fy2), color, rfpart(fy2) * 0.5f);
+    wu_plot(&box, steep, xe, (int)floor(fy2) + 1, color, fpart(fy2) * 0.5f);
+
+    /* 长轴范围与可绘制区域求交 */
+    int lo = steep ? box.y0 : box.x0;
+    int hi = steep ? box.y1 - 1 : box.x1 - 1;
+    int from = xs + 1 > lo ? xs + 1 : lo;
+    int to = xe - 1 < hi ? xe - 1 : hi;
+
+    if (from > to) return;
+
+    /* 短轴范围：像素对 (y, y + 1) 至少一个可见为 [mlo - 1, mhi]，两个都可见为 [mlo, mhi - 1] */
+    int mlo = steep ? box.x0 : box.y0;
+    int mhi = steep ? box.x1 - 1 : box.y1 - 1;
+    int64_t step = (int64_t)llround(gradient * 65536.0);
+    int64_t fy = (int64_t)llround((fy1 + gradient * (from - fx1)) * 65536.0);
+    int n = to - from + 1;
+    int v0, v1, s0, s1;
+    wu_range(fy, step, n, mlo - 1, mhi, &v0, &v1);
+    if (v0 > v1) return;
+    wu_range(fy, step, n, mlo, mhi - 1, &s0, &s1);
+    if (s0 > s1) s0 = s1 = v1 + 1;     /* 没有两个都可见的部分 */
+
+    int k = v0;
+    fy += step * v0;
+    for (; k < s0; k++, fy += step) wu_pair(&box, steep, from + k, fy, color);
+    for (; k <= s1 && k <= v1; k++, fy += step) wu_pair(NULL, steep, from + k, fy, color);
+    for (; k <= v1; k++, fy += step) wu_pair(&box, steep, from + k, fy, color);
+}
+
+/*
+* 绘制粗直线
+* 把线段沿法线方向扩展为宽 width 的四边形（平头端点），逐扫描线求出四边形覆盖的水平范围，
+* 范围内每个像素按像素中心到四条边的距离计算覆盖度（边缘 1 像素过渡），
+* 再用与文字相同的覆盖度混合写入，内部完全覆盖的像素直接写入颜色。
+*/
+void lcd_draw_thick_line(int x1, int y1, int x2, int y2, int width, color_t color) {
+    if (!lcd || width <= 0) return;
+
+    float dx = (float)(x2 - x1), dy = (float)(y2 - y1);
+    float len = (float)sqrt(dx * dx + dy * dy);
+    float ux = len > 0 ? dx / len : 1.0f, uy = len > 0 ? dy / len : 0.0f;   /* 线段方向 */
+    float nx = -uy, ny = ux;                                                /* 法线方向 */
+    float half = width / 2.0f + 0.5f;       /* 含 0.5 像素过渡带的半宽 */
+    float ax = x1 + 0.5f, ay = y1 + 0.5f;   /* 起点取像素中心 */
+
+    /* 四边形（含过渡带）的包围盒与可绘制区域求交 */
+    float ex = (float)fabs(nx) * half + (float)fabs(ux) * 0.5f;
+    float ey = (float)fabs(ny) * half + (float)fabs(uy) * 0.5f;
+    int row0 = (int)floor((y1 < y2 ? y1 : y2) + 0.5f - ey);
+    int row1 = (int)ceil((y1 > y2 ? y1 : y2) + 0.5f + ey);
+    int col0 = (int)floor((x1 < x2 ? x1 : x2) + 0.5f - ex);
+    int col1 = (int)ceil((x1 > x2 ? x1 : x2) + 0.5f + ex);
+    if (!clip_to_target(&col0, &row0, &col1, &row1)) return;
+
+    unsigned char coverage[256];    /* 每次处理一段不超过 256 像素的扫描线 */
+    for (int y = row0; y < row1; y++) {
+        float py = y + 0.5f - ay;
 
         /*
-        * 调用 decode_utf8 函数将 UTF-8 字符解码为 Unicode 码点 codepoint，
-        * 并获取该字符的字节长度 char_len
+        * 求该扫描线上覆盖度可能非 0 的 x 范围：
+        * 法向距离 |d| <= half，轴向位置 -0.5 <= t <= len + 0.5，d、t 都是 x 的一次函数。
         */
-        int char_len = decode_utf8(&text[i], &codepoint);
-        
-        if (codepoint < 32) { /* 跳过 ASCII 码小于 32 的控制字符 */ 
-            i += char_len;
+        float xl = (float)col0, xr = (float)col1;
+        float d0 = py * ny, t0 = py * uy;   /* px = ax 处的 d、t */
+        if (fabs(nx) > 1e-6f) {
+            float a = (-half - d0) / nx + ax, b = (half - d0) / nx + ax;
+            if (a > b) { float t = a; a = b; b = t; }
+            if (a > xl) xl = a;
+            if (b < xr) xr = b;
+        } else if (fabs(d0) > half) {
             continue;
         }
-        
-        /* 获取字符度量信息与位图 */
-        int advance, lsb, x0, y0, x1, y1;
-        float x_shift = xpos - (float)floor(xpos);
-        
-        /* 获取当前字符的水平度量信息，包括字符的前进宽度 advance 和左部空白 lsb */
-        stbtt_GetCodepointHMetrics(&font, codepoint, &advance, &lsb);
+        if (fabs(ux) > 1e-6f) {
+            float a = (-0.5f - t0) / ux + ax, b = (len + 0.5f - t0) / ux + ax;
+            if (a > b) { float t = a; a = b; b = t; }
+            if (a > xl) xl = a;
+            if (b < xr) xr = b;
+        } else if (t0 < -0.5f || t0 > len + 0.5f) {
+            continue;
+        }
+        int start = (int)floor(xl - 0.5f);
+        int end = (int)ceil(xr - 0.5f) + 1;
+        if (start < col0) start = col0;
+        if (end > col1) end = col1;
 
-        /* stbtt_GetCodepointBitmapBoxSubpixel：获取当前字符位图的边界框坐标 (x0, y0, x1, y1) */
-        stbtt_GetCodepointBitmapBoxSubpixel(&font, codepoint, scale, scale, x_shift, 0, &x0, &y0, &x1, &y1);
+        /* 逐段计算覆盖度并混合 */
+        for (int seg = start; seg < end; seg += (int)sizeof(coverage)) {
+            int n = end - seg < (int)sizeof(coverage) ? end - seg : (int)sizeof(coverage);
+            for (int i = 0; i < n; i++) {
+                float px = seg + i + 0.5f - ax;
+                float d = (float)fabs(px * nx + py * ny);
+                float t = px * ux + py * uy;
+                float cd = half - d;                                    /* 到两条长边的余量 */
+                float ct = (t < len - t ? t : len - t) + 0.5f;          /* 到两个端点的余量 */
+                float c = (cd < 1.0f ? cd : 1.0f) * (ct < 1.0f ? ct : 1.0f);
+                coverage[i] = c <= 0 ? 0 : (unsigned char)(c * 255.0f + 0.5f);
+            }
+            blend_coverage(coverage, n, 1, seg, y, color, seg, y, seg + n, y + 1);
+        }
+    }
+}
 
-        int width = x1 - x0;
-        int height = y1 - y0;
-        unsigned char *bitmap = (unsigned char*)malloc(width * height);     /* 为当前字符的位图分配内存 */
-        
-        /* 生成字符位图并渲染 */
-        if (bitmap) {
-            stbtt_MakeCodepointBitmapSubpixel(&font, bitmap, width, height, width, scale, scale, x_shift, 0, codepoint);
-            
-            for (int j = 0; j < height; ++j) {
-                for (int i = 0; i < width; ++i) {
-                    int screen_x = (int)xpos + x0 + i;  /* 计算该像素在屏幕上的坐标 (screen_x, screen_y) */
-                    int screen_y = baseline + y0 + j + y;
-                    /* 检查坐标是否在屏幕范围内 */
-                    if (screen_x >= 0 && screen_x < lcd->width && screen_y >= 0 && screen_y < lcd->height) {
-                        unsigned char alpha = bitmap[j * width + i];
-                        /* 
-                        * 获取该像素的透明度 alpha
-                        * 若 alpha > 0，进行简单的 alpha 混合，
-                        * 将前景色和背景色按透明度混合后更新屏幕缓冲区。
-                        */
-
-                        if (alpha > 0) {    
-                            uint16_t bg = lcd->mp[screen_y * lcd->width + screen_x];
-                            // 修改为使用 text_color
-                            uint16_t r = ((bg & 0xF800) * (255 - alpha) + (text_color & 0xF800) * alpha) / 255;
-                            uint16_t g = ((bg & 0x07E0) * (255 - alpha) + (text_color & 0x07E0) * alpha) / 255;
-                            uint16_t b = ((bg & 0x001F) * (255 - alpha) + (text_color & 0x001F) * alpha) / 255;
-                            lcd->mp[screen_y * lcd->width + screen_x] = r | g | b;
-                        }
+/*
+* 通用 LRU 缓存
+* 字形缓存与字符串缓存共用的 LRU 链表、哈希桶和字节预算管理。缓存项以 CacheNode 作为
+* 第一个成员，整项一次 malloc 分配；查找时由调用者按各自的键比较桶内的节点。
+*/
+typedef struct CacheNode {
+    struct CacheNode *prev;         /* LRU 链表前驱（较近使用） */
+    struct CacheNode *next;         /* LRU 链表后继（较久未用） */
+    struct CacheNode *hash_next;    /* 同一哈希桶中的下一项 */
+    unsigned int hash;              /* 键的哈希值 */
+    size_t bytes;                   /* 该项占用的字节数 */
+} CacheNode;
+
+typedef struct {
+    CacheNode **buckets;        /* 哈希桶，首次插入时分配 */
+    unsigned int bucket_count;  /* 哈希桶数量，必须是 2 的幂 */
+    CacheNode *head;            /* 最近使用的项 */
+    CacheNode *tail;            /* 最久未用的项 */
+    size_t bytes;               /* 当前占用字节数 */
+    size_t budget;              /* 字节预算，为 0 时不缓存 */
+} Cache;
+
+/* 从 LRU 链表中摘下节点 */
+static void cache_unlink(Cache *cache, CacheNode *node) {
+    if (node->prev) node->prev->next = node->next; else cache->head = node->next;
+    if (node->next) node->next->prev = node->prev; else cache->tail = node->prev;
+    node->prev = node->next = NULL;
+}
+
+/* 把节点放到 LRU 链表头部 */
+static void cache_link_head(Cache *cache, CacheNode *node) {
+    node->prev = NULL;
+    node->next = cache->head;
+    if (cache->head) cache->head->prev = node; else cache->tail = node;
+    cache->head = node;
+}
+
+/* 移除并释放一项 */
+static void cache_remove(Cache *cache, CacheNode *node) {
+    CacheNode **link = &cache->buckets[node->hash & (cache->bucket_count - 1)];
+    while (*link != node) link = &(*link)->hash_next;
+    *link = node->hash_next;
+    cache_unlink(cache, node);
+    cache->bytes -= node->bytes;
+    free(node);
+}
+
+/* 命中后标记为最近使用 */
+static void cache_touch(Cache *cache, CacheNode *node) {
+    if (cache->head != node) {
+        cache_unlink(cache, node);
+        cache_link_head(cache, node);
+    }
+}
+
+/* 返回哈希值对应桶的第一项 */
+static CacheNode *cache_bucket(const Cache *cache, unsigned int hash) {
+    return cache->buckets ? cache->buckets[hash & (cache->bucket_count - 1)] : NULL;
+}
+
+/* 淘汰最久未用的项，直到占用不超过 limit 字节 */
+static void cache_trim(Cache *cache, size_t limit) {
+    while (cache->tail && cache->bytes > limit) {
+        cache_remove(cache, cache->tail);
+    }
+}
+
+/*
+* 插入一项
+* 该项大于整个预算时插入失败返回 -1，由调用者负责释放；否则先淘汰旧项腾出空间再插入。
+*/
+static int cache_insert(Cache *cache, CacheNode *node) {
+    if (node->bytes > cache->budget) return -1;
+    if (!cache->buckets) {
+        cache->buckets = (CacheNode**)calloc(cache->bucket_count, sizeof(CacheNode*));
+        if (!cache->buckets) return -1;
+    }
+    cache_trim(cache, cache->budget - node->bytes);
+
+    CacheNode **bucket = &cache->buckets[node->hash & (cache->bucket_count - 1)];
+    node->hash_next = *bucket;
+    *bucket = node;
+    cache_link_head(cache, node);
+    cache->bytes += node->bytes;
+    return 0;
+}
+
+/* 清空缓存并释放哈希桶 */
+static void cache_clear(Cache *cache) {
+    if (cache->buckets) {
+        cache_trim(cache, 0);
+        free(cache->buckets);
+        cache->buckets = NULL;
+    }
+}
+
+/* FNV-1a 哈希 */
+static unsigned int hash_bytes(unsigned int hash, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char*)data;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/*
+* 字形轮廓缓存
+* stb_truetype 每次光栅化字形都要解析 glyf 表生成轮廓顶点，光栅化后再释放。轮廓与字体大小、亚像素偏移无关，
+* 以（字体，字形索引）为键缓存顶点数组与字形包围盒后，同一字形换一个大小或亚像素偏移光栅化时
+* 不再读取 glyf 表，直接展平曲线并扫描转换。缓存项连同顶点一次分配，按字节预算以最近最少使用淘汰。
+*/
+#define OUTLINE_CACHE_BUCKETS           512             /* 轮廓缓存哈希桶数量 */
+#define OUTLINE_CACHE_DEFAULT_BUDGET    (256 * 1024)    /* 轮廓缓存默认字节预算 */
+
+typedef struct {
+    CacheNode node;             /* 缓存节点，必须是第一个成员 */
+    int id;                     /* 字形索引 | (字体序号 << KEY_GLYPH_SHIFT) */
+    int has_box;                /* 字形是否有包围盒，空白字符没有 */
+    int x0, y0, x1, y1;         /* 字形包围盒（字体单位） */
+    int count;                  /* 顶点数量 */
+    stbtt_vertex vertices[];    /* 轮廓顶点 */
+} OutlineEntry;
+
+static Cache outline_cache = { NULL, OUTLINE_CACHE_BUCKETS, NULL, NULL, 0, OUTLINE_CACHE_DEFAULT_BUDGET };
+static OutlineEntry *outline_uncached = NULL;   /* 无法放入缓存的轮廓，下一次未命中时释放 */
+
+/* 获取字体 face 中字形 glyph 的轮廓，命中时直接返回，未命中时解析并插入缓存 */
+static const OutlineEntry *outline_cache_get(const lcd_font_t *face, int glyph) {
+    int id = glyph | ((int)(face - faces) << KEY_GLYPH_SHIFT);
+    unsigned int hash = hash_bytes(2166136261u, &id, sizeof(id));
+    for (CacheNode *node = cache_bucket(&outline_cache, hash); node; node = node->hash_next) {
+        OutlineEntry *entry = (OutlineEntry*)node;
+        if (node->hash == hash && entry->id == id) {
+            cache_touch(&outline_cache, node);
+            return entry;
+        }
+    }
+
+    stbtt_vertex *vertices = NULL;
+    int count = stbtt_GetGlyphShape(&face->info, glyph, &vertices);
+    size_t bytes = sizeof(OutlineEntry) + (size_t)count * sizeof(stbtt_vertex);
+    OutlineEntry *entry = (OutlineEntry*)malloc(bytes);
+    if (!entry) {
+        stbtt_FreeShape(&face->info, vertices);
+        return NULL;
+    }
+    entry->id = id;
+    entry->has_box = stbtt_GetGlyphBox(&face->info, glyph, &entry->x0, &entry->y0, &entry->x1, &entry->y1);
+    entry->count = count;
+    if (count > 0) memcpy(entry->vertices, vertices, count * sizeof(stbtt_vertex));
+    stbtt_FreeShape(&face->info, vertices);
+    entry->node.hash = hash;
+    entry->node.bytes = bytes;
+
+    free(outline_uncached);
+    outline_uncached = NULL;
+    if (cache_insert(&outline_cache, &entry->node) != 0) {
+        outline_uncached = entry;
+    }
+    return entry;
+}
+
+/* 设置轮廓缓存的字节预算 */
+void lcd_set_outline_cache_budget(size_t bytes) {
+    outline_cache.budget = bytes;
+    cache_trim(&outline_cache, bytes);
+}
+
+/*
+* 字形缓存（一级缓存）
+* 以（字形键，字体大小，亚像素偏移档位）为键缓存字形的 8 位覆盖度位图，字形键中包含字体序号。亚像素偏移量化为
+* GLYPH_SUBPIXEL_STEPS 档，同一字符在不同笔位下最多只需光栅化这么多次。
+*/
+#define GLYPH_SUBPIXEL_STEPS        4               /* 亚像素偏移档位数 */
+#define GLYPH_SUBPIXEL_MONO         -1              /* 1 位蒙版字形的档位：按整数笔位光栅化 */
+#define GLYPH_FORMAT_A1             (LCD_GLYPH_A4_RLE + 1)  /* 1 位蒙版存储格式（LCD_TEXT_MONO 方式内部使用） */
+#define GLYPH_MONO_THRESHOLD        128             /* 覆盖度不低于该值的像素属于 1 位蒙版 */
+#define GLYPH_CACHE_BUCKETS         1024            /* 字形缓存哈希桶数量 */
+#define GLYPH_CACHE_DEFAULT_BUDGET  (512 * 1024)    /* 字形缓存默认字节预算 */
+
+typedef struct {
+    CacheNode node;             /* 缓存节点，必须是第一个成员 */
+    int key;                    /* 字形键（码点或 GLYPH_KEY(字形索引)） */
+    int size;                   /* 字体大小 */
+    int subpixel;               /* 亚像素偏移档位 */
+    int format;                 /* 位图存储格式 */
+    int x0, y0;                 /* 位图左上角相对（笔位整数部分，基线）的偏移 */
+    int width, height;          /* 位图尺寸，空白字符为 0 */
+    unsigned char bitmap[];     /* 覆盖度位图，按 format 存储 */
+} GlyphEntry;
+
+static Cache glyph_cache = { NULL, GLYPH_CACHE_BUCKETS, NULL, NULL, 0, GLYPH_CACHE_DEFAULT_BUDGET };
+static GlyphEntry *glyph_uncached = NULL;   /* 无法放入缓存的字形，下一次未命中时释放 */
+static lcd_glyph_format_t glyph_format = LCD_GLYPH_A8;  /* 新缓存字形的存储格式 */
+static unsigned char *glyph_scratch = NULL; /* 压缩字形解码或编码用的 8 位覆盖度缓冲区 */
+static size_t glyph_scratch_size = 0;
+
+/* 把 glyph_scratch 扩大到至少 bytes 字节，失败返回 NULL */
+static unsigned char *glyph_scratch_reserve(size_t bytes) {
+    if (bytes > glyph_scratch_size) {
+        unsigned char *scratch = (unsigned char*)realloc(glyph_scratch, bytes);
+        if (!scratch) return NULL;
+        glyph_scratch = scratch;
+        glyph_scratch_size = bytes;
+    }
+    return glyph_scratch;
+}
+
+/* 8 位覆盖度量化为 4 位（四舍五入） */
+static inline unsigned int quantize4(unsigned int alpha) {
+    return (alpha * 15 + 127) / 255;
+}
+
+/*
+* 编码覆盖度位图
+* 把 width x height 的 8 位覆盖度按 format 编码到 out，返回编码后的字节数；out 为 NULL 时只计算字节数。
+* 1 位蒙版：每行按 32 位字对齐，像素 i 对应第 i / 32 个字的第 i % 32 位（低位在前）。
+* 游程编码：4 位量化后为 0 或 15 的像素连续至少 2 个时记为游程，其余像素合并为直接存储记号。
+*/
+static size_t glyph_encode(const unsigned char *bitmap, int width, int height, int format, unsigned char *out) {
+    if (format == LCD_GLYPH_A8) {
+        if (out) memcpy(out, bitmap, (size_t)width * height);
+        return (size_t)width * height;
+    }
+    if (format == LCD_GLYPH_A4) {
+        int pitch = (width + 1) >> 1;
+        if (out) {
+            memset(out, 0, (size_t)pitch * height);
+            for (int j = 0; j < height; j++) {
+                for (int i = 0; i < width; i++) {
+                    out[j * pitch + (i >> 1)] |= quantize4(bitmap[j * width + i]) << ((i & 1) << 2);
+                }
+            }
+        }
+        return (size_t)pitch * height;
+    }
+    if (format == GLYPH_FORMAT_A1) {
+        int words = (width + 31) >> 5;
+        if (out) {
+            for (int j = 0; j < height; j++) {
+                for (int w = 0; w < words; w++) {
+                    uint32_t bits = 0;
+                    for (int i = w << 5; i < width && i < (w + 1) << 5; i++) {
+                        if (bitmap[j * width + i] >= GLYPH_MONO_THRESHOLD) bits |= 1u << (i & 31);
                     }
+                    memcpy(out + (j * words + w) * 4, &bits, 4);
                 }
             }
-            free(bitmap);   /* 释放为位图分配的内存 */
         }
+        return (size_t)words * 4 * height;
+    }
 
-        /* 更新 x 坐标并处理下一个字符 */
-        xpos += (advance * scale);  /* 更新 x 坐标，加上当前字符的前进宽度 */
-        if (i + char_len < len) {   /* 若不是最后一个字符，获取下一个字符的码点，计算并加上字距调整值 */
-            int next_codepoint;
-            decode_utf8(&text[i + char_len], &next_codepoint);
-            xpos += scale * stbtt_GetCodepointKernAdvance(&font, codepoint, next_codepoint);
+    size_t bytes = 0;
+    for (int j = 0; j < height; j++) {
+        const unsigned char *row = bitmap + j * width;
+        int i = 0;
+        while (i < width) {
+            unsigned int q = quantize4(row[i]);
+            int n = 1;
+            if (q == 0 || q == 15) {
+                while (i + n < width && n < 64 && quantize4(row[i + n]) == q) n++;
+            }
+            if ((q == 0 || q == 15) && (n >= 2 || i + n == width)) {   /* 游程 */
+                if (out) out[bytes] = (unsigned char)((q ? RLE_FULL : RLE_EMPTY) | (n - 1));
+                bytes++;
+            } else {                                                    /* 直接存储，遇到长度至少为 2 的游程时结束 */
+                n = 1;
+                while (i + n < width && n < 128) {
+                    unsigned int v = quantize4(row[i + n]);
+                    if ((v == 0 || v == 15) && i + n + 1 < width && quantize4(row[i + n + 1]) == v) break;
+                    n++;
+                }
+                if (out) {
+                    out[bytes] = (unsigned char)(RLE_LITERAL | (n - 1));
+                    memset(out + bytes + 1, 0, (n + 1) >> 1);
+                    for (int k = 0; k < n; k++) out[bytes + 1 + (k >> 1)] |= quantize4(row[i + k]) << ((k & 1) << 2);
+                }
+                bytes += 1 + ((n + 1) >> 1);
+            }
+            i += n;
         }
-        
-        i += char_len;  /* 处理下一个字符 */
     }
+    return bytes;
 }
 
-/* 渲染文字（带文本框） */
-void lcd_render_text_with_box(const char *text, int x, int y, color_t text_color, 
-                              color_t box_color, int padding, BoxStyle style, int radius, int font_size,
-                              int box_width, int box_height) {
-    /* 
-    * text：指向要渲染的 UTF-8 编码文本字符串的指针。
-    * x、y：文本渲染起始位置的坐标。
-    * text_color：文本的颜色。
-    * box_color：文本框的填充颜色。
-    * padding：文本与文本框边缘的间距。
-    * style：文本框的样式，类型为 BoxStyle，可能是矩形或圆角矩形。
-    * radius：若 style 为圆角矩形，该参数指定圆角的半径。 
-    * font_size：文本的字体大小。
-    * box_width：文本框的宽度（长），为 0 时，根据文本量与字体大小调整，文字居中对齐。
-    * box_height：文本框的高度（宽），为 0 时，根据文本量与字体大小调整，文字居中对齐。
-    */
-    if (!text || !lcd) return;
-    
-    /* 设置字体大小 */ 
-    lcd_set_font_size(font_size);
+/* 取得字形的 8 位覆盖度：A8 格式直接返回位图，其他格式解码到 glyph_scratch（1 位蒙版解码为 0 或 255），失败返回 NULL */
+static const unsigned char *glyph_coverage(const GlyphEntry *glyph) {
+    if (glyph->format == LCD_GLYPH_A8) return glyph->bitmap;
+    unsigned char *out = glyph_scratch_reserve((size_t)glyph->width * glyph->height);
+    if (!out) return NULL;
+    if (glyph->format == GLYPH_FORMAT_A1) {
+        int words = (glyph->width + 31) >> 5;
+        for (int j = 0; j < glyph->height; j++) {
+            for (int i = 0; i < glyph->width; i++) {
+                uint32_t bits;
+                memcpy(&bits, glyph->bitmap + (j * words + (i >> 5)) * 4, 4);
+                out[j * glyph->width + i] = bits >> (i & 31) & 1 ? 255 : 0;
+            }
+        }
+        return out;
+    }
+    if (glyph->format == LCD_GLYPH_A4) {
+        int pitch = (glyph->width + 1) >> 1;
+        for (int j = 0; j < glyph->height; j++) {
+            for (int i = 0; i < glyph->width; i++) {
+                out[j * glyph->width + i] = (unsigned char)nibble_alpha(glyph->bitmap + j * pitch, i);
+            }
+        }
+        return out;
+    }
+    const unsigned char *p = glyph->bitmap;
+    for (int j = 0; j < glyph->height; j++) {
+        unsigned char *row = out + j * glyph->width;
+        for (int i = 0; i < glyph->width; ) {
+            unsigned int token = *p++;
+            int n = (token & (token & RLE_LITERAL ? 0x7F : 0x3F)) + 1;
+            if (token & RLE_LITERAL) {
+                for (int k = 0; k < n; k++) row[i + k] = (unsigned char)nibble_alpha(p, k);
+                p += (n + 1) >> 1;
+            } else {
+                memset(row + i, token & RLE_FULL ? 255 : 0, n);
+            }
+            i += n;
+        }
+    }
+    return out;
+}
 
-    /* 如果 box_width 或 box_height 为 0，则根据文本内容计算文本框大小 */
-    if (box_width == 0 || box_height == 0) {
-        box_width = lcd_get_text_width(text) + 2 * padding;
-        box_height = lcd_get_text_height() + 2 * padding;
+/* 笔位小数部分对应的亚像素档位 */
+static inline int glyph_subpixel(float xpos) {
+    int subpixel = (int)((xpos - (float)floor(xpos)) * GLYPH_SUBPIXEL_STEPS);
+    return subpixel < GLYPH_SUBPIXEL_STEPS ? subpixel : GLYPH_SUBPIXEL_STEPS - 1;
+}
+
+/* 字形缓存项的哈希值 */
+static unsigned int glyph_hash(int key, int size, int subpixel) {
+    int id[3] = { key, size, subpixel };
+    return hash_bytes(2166136261u, id, sizeof(id));
+}
+
+/* 在字形缓存中查找，未命中返回 NULL */
+static GlyphEntry *glyph_cache_find(int key, int size, int subpixel, unsigned int hash) {
+    for (CacheNode *node = cache_bucket(&glyph_cache, hash); node; node = node->hash_next) {
+        GlyphEntry *entry = (GlyphEntry*)node;
+        if (node->hash == hash && entry->key == key &&
+            entry->size == size && entry->subpixel == subpixel) {
+            return entry;
+        }
     }
+    return NULL;
+}
 
-    /* 
-    * 绘制文本框
-    * 若 style 为 BOX_STYLE_RECTANGLE，调用 lcd_draw_filled_rectangle 函数绘制填充矩形文本框。
-    * 矩形左上角坐标为 (x - padding, y - padding)，宽度为 box_width，
-    * 高度为 box_height，颜色为 box_color。
-    *
-    * 若 style 不是 BOX_STYLE_RECTANGLE，调用 lcd_draw_filled_rounded_rectangle 函数绘制
-    * 填充圆角矩形文本框，参数含义与矩形类似，额外传入圆角半径 radius。
-    */ 
-    if (style == BOX_STYLE_RECTANGLE) {
-        lcd_draw_filled_rectangle(x - padding, y - padding, box_width, box_height, box_color);
+/*
+* 光栅化字形，生成尚未插入缓存的缓存项
+* info：字形所属的字体。glyph：字形索引。scale：缩放比例。
+* outline：字形的缓存轮廓，包围盒与扫描转换都直接使用其中的数据，结果与 stbtt_MakeGlyphBitmapSubpixel 一致。
+* outline 为 NULL 时由 stb_truetype 解析轮廓；此时只读取字体信息，不访问缓存与全局状态，可以在后台线程中调用。
+* format：位图存储格式。压缩格式先光栅化到临时的 8 位位图，再按实际编码长度分配缓存项。
+*/
+static GlyphEntry *glyph_rasterize(const stbtt_fontinfo *info, int glyph, const OutlineEntry *outline,
+                                   float scale, int key, int size, int subpixel, int format) {
+    float x_shift = subpixel > 0 ? (float)subpixel / GLYPH_SUBPIXEL_STEPS : 0;
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    if (!outline) {
+        stbtt_GetGlyphBitmapBoxSubpixel(info, glyph, scale, scale, x_shift, 0, &x0, &y0, &x1, &y1);
+    } else if (outline->has_box) {      /* 与 stbtt_GetGlyphBitmapBoxSubpixel 相同的取整方式 */
+        x0 = (int)floor(outline->x0 * scale + x_shift);
+        y0 = (int)floor(-outline->y1 * scale);
+        x1 = (int)ceil(outline->x1 * scale + x_shift);
+        y1 = (int)ceil(-outline->y0 * scale);
+    }
+    int width = x1 > x0 ? x1 - x0 : 0;
+    int height = y1 > y0 ? y1 - y0 : 0;
+    if (width == 0 || height == 0) width = height = 0;
+
+    /* A8 格式直接光栅化到缓存项中；压缩格式先光栅化到临时位图，编码长度确定后再分配缓存项 */
+    int compress = format != LCD_GLYPH_A8 && width > 0;
+    size_t bytes = (size_t)width * height;
+    GlyphEntry *entry = NULL;
+    unsigned char *pixels = NULL;
+    if (compress) {
+        pixels = (unsigned char*)malloc(bytes);
+        if (!pixels) return NULL;
     } else {
-        lcd_draw_filled_rounded_rectangle(x - padding, y - padding, box_width, box_height, radius, box_color);
+        entry = (GlyphEntry*)malloc(sizeof(GlyphEntry) + bytes);
+        if (!entry) return NULL;
+        pixels = entry->bitmap;
     }
-    
-    /* 
-    * 绘制文字
-    * 调用 lcd_render_text 函数在指定位置 (x, y) 以 text_color 颜色渲染文本 text
-    */ 
-    lcd_render_text(text, x, y, text_color, font_size);
+
+    if (width > 0 && outline) {
+        stbtt__bitmap gbm = { width, height, width, pixels };
+        stbtt_Rasterize(&gbm, 0.35f, (stbtt_vertex*)outline->vertices, outline->count,
+                        scale, scale, x_shift, 0, x0, y0, 1, NULL);
+    } else if (width > 0) {
+        stbtt_MakeGlyphBitmapSubpixel(info, pixels, width, height, width,
+                                      scale, scale, x_shift, 0, glyph);
+    }
+
+    if (compress) {
+        bytes = glyph_encode(pixels, width, height, format, NULL);
+        entry = (GlyphEntry*)malloc(sizeof(GlyphEntry) + bytes);
+        if (entry) glyph_encode(pixels, width, height, format, entry->bitmap);
+        free(pixels);
+        if (!entry) return NULL;
+    }
+    entry->key = key;
+    entry->size = size;
+    entry->subpixel = subpixel;
+    entry->format = compress ? format : LCD_GLYPH_A8;
+    entry->x0 = x0;
+    entry->y0 = y0;
+    entry->width = width;
+    entry->height = height;
+    entry->node.hash = glyph_hash(key, size, subpixel);
+    entry->node.bytes = sizeof(GlyphEntry) + bytes;
+    return entry;
 }
 
+/*
+* 获取字形
+* 命中时直接返回缓存项；未命中时光栅化并插入缓存。返回的指针在下一次调用本函数之前有效。
+* subpixel 为 GLYPH_SUBPIXEL_MONO 时取得 1 位蒙版字形，与同一字形的覆盖度位图分别缓存。
+*/
+static const GlyphEntry *glyph_cache_get(int key, int size, int subpixel) {
+    GlyphEntry *entry = glyph_cache_find(key, size, subpixel, glyph_hash(key, size, subpixel));
+    if (entry) {
+        cache_touch(&glyph_cache, &entry->node);
+        return entry;
+    }
+
+    /* 未命中：用字形键所属字体的缓存轮廓按量化后的亚像素偏移光栅化 */
+    const lcd_font_t *face = key_face(key);
+    int glyph = key_glyph(key);
+    const OutlineEntry *outline = outline_cache.budget ? outline_cache_get(face, glyph) : NULL;
+    float scale = stbtt_ScaleForPixelHeight(font, size) * key_ratio(key);
+    int format = subpixel == GLYPH_SUBPIXEL_MONO ? GLYPH_FORMAT_A1 : (int)glyph_format;
+    entry = glyph_rasterize(&face->info, glyph, outline, scale, key, size, subpixel, format);
+    if (!entry) return NULL;
+
+    free(glyph_uncached);
+    glyph_uncached = NULL;
+    if (cache_insert(&glyph_cache, &entry->node) != 0) {
+        glyph_uncached = entry;
+    }
+    return entry;
+}
+
+/*
+* 距离场字形缓存
+* 每个字形只按 SDF_SIZE 像素的字体大小生成一份有向距离场（stbtt_GetGlyphSDF），以字形键为键缓存，
+* 与字体大小无关。渲染任意大小时按比例双线性采样距离场，在轮廓附近一个输出像素宽的范围内把距离
+* 线性映射为覆盖度，再与普通字形一样混合。字体大小连续变化（缩放动画）时不再需要逐个大小光栅化。
+*/
+#define SDF_SIZE                    32              /* 生成距离场时的字体大小 */
+#define SDF_PADDING                 4               /* 距离场在字形外侧延伸的像素数 */
+#define SDF_ONEDGE                  128             /* 轮廓上的距离值 */
+#define SDF_DIST_SCALE              (128.0f / SDF_PADDING)  /* 距离每变化 1 像素对应的距离值 */
+#define SDF_CACHE_BUCKETS           512             /* 距离场缓存哈希桶数量 */
+#define SDF_CACHE_DEFAULT_BUDGET    (256 * 1024)    /* 距离场缓存默认字节预算 */
+
+typedef struct {
+    CacheNode node;             /* 缓存节点，必须是第一个成员 */
+    int key;                    /* 字形键 */
+    int x0, y0;                 /* 距离场左上角相对（笔位，基线）的偏移，单位为 SDF_SIZE 下的像素 */
+    int width, height;          /* 距离场尺寸（不含四周各 1 像素的 0 边框），空白字符为 0 */
+    unsigned char field[];      /* 距离场，(width + 2) x (height + 2)，四周各有 1 像素的 0 边框 */
+} SdfEntry;
+
+static Cache sdf_cache = { NULL, SDF_CACHE_BUCKETS, NULL, NULL, 0, SDF_CACHE_DEFAULT_BUDGET };
+static SdfEntry *sdf_uncached = NULL;       /* 无法放入缓存的距离场，下一次未命中时释放 */
+static lcd_text_mode_t text_mode = LCD_TEXT_EXACT;     /* 文字渲染方式 */
+static unsigned char *sdf_scratch = NULL;   /* 采样结果（覆盖度）缓冲区 */
+static size_t sdf_scratch_size = 0;
+
+/*
+* 获取距离场
+* 逻辑：命中时直接返回；未命中时按字形所属字体在 SDF_SIZE 下的缩放比例生成距离场，
+*      复制到带 0 边框的缓存项中，采样时双线性插值的四个采样点总在边框以内，不需要逐点检查边界。
+*/
+static const SdfEntry *sdf_cache_get(int key) {
+    unsigned int hash = hash_bytes(2166136261u, &key, sizeof(key));
+    for (CacheNode *node = cache_bucket(&sdf_cache, hash); node; node = node->hash_next) {
+        SdfEntry *entry = (SdfEntry*)node;
+        if (node->hash == hash && entry->key == key) {
+            cache_touch(&sdf_cache, node);
+            return entry;
+        }
+    }
+
+    const lcd_font_t *face = key_face(key);
+    int width = 0, height = 0, xoff = 0, yoff = 0;
+    unsigned char *field = stbtt_GetGlyphSDF(&face->info, face->em_scale * SDF_SIZE, key_glyph(key),
+                                             SDF_PADDING, SDF_ONEDGE, SDF_DIST_SCALE,
+                                             &width, &height, &xoff, &yoff);
+    if (!field) width = height = 0;     /* 空白字符没有距离场 */
+
+    size_t bytes = sizeof(SdfEntry) + (size_t)(width + 2) * (height + 2);
+    SdfEntry *entry = (SdfEntry*)calloc(1, bytes);
+    if (!entry) {
+        stbtt_FreeSDF(field, NULL);
+        return NULL;
+    }
+    entry->key = key;
+    entry->x0 = xoff;
+    entry->y0 = yoff;
+    entry->width = width;
+    entry->height = height;
+    for (int j = 0; j < height; j++) {
+        memcpy(entry->field + (j + 1) * (width + 2) + 1, field + j * width, width);
+    }
+    stbtt_FreeSDF(field, NULL);
+    entry->node.hash = hash;
+    entry->node.bytes = bytes;
+
+    free(sdf_uncached);
+    sdf_uncached = NULL;
+    if (cache_insert(&sdf_cache, &entry->node) != 0) {
+        sdf_uncached = entry;
+    }
+    return entry;
+}
+
+/*
+* 由距离场渲染单个字形
+* 逻辑：距离场按 r = size / SDF_SIZE 缩放后覆盖的输出矩形先与裁剪矩形求交，只计算可见像素。
+*      每个输出像素中心映射回距离场坐标（16.16 定点数，逐像素只做加法），双线性插值得到距离值 d，
+*      覆盖度 = 0.5 + (d - SDF_ONEDGE) / SDF_DIST_SCALE * r，即轮廓两侧各半个输出像素内线性过渡。
+*      采样结果写入覆盖度缓冲区后与普通字形一样混合。
+*/
+static void render_glyph_sdf(int key, float xpos, int baseline_y, int size, color_t color,
+                             int clip_x0, int clip_y0, int clip_x1, int clip_y1) {
+    const SdfEntry *sdf = sdf_cache_get(key);
+    if (!sdf || sdf->width == 0) return;
+
+    float r = (float)size / SDF_SIZE;
+    float left = xpos + sdf->x0 * r;
+    float top = baseline_y + sdf->y0 * r;
+    int x0 = (int)floor(left), y0 = (int)floor(top);
+    int x1 = (int)ceil(left + sdf->width * r), y1 = (int)ceil(top + sdf->height * r);
+    if (x0 < clip_x0) x0 = clip_x0;
+    if (y0 < clip_y0) y0 = clip_y0;
+    if (x1 > clip_x1) x1 = clip_x1;
+    if (y1 > clip_y1) y1 = clip_y1;
+    if (!clip_to_target(&x0, &y0, &x1, &y1)) return;
+
+    int w = x1 - x0, h = y1 - y0;
+    if ((size_t)w * h > sdf_scratch_size) {
+        unsigned char *scratch = (unsigned char*)realloc(sdf_scratch, (size_t)w * h);
+        if (!scratch) return;
+        sdf_scratch = scratch;
+        sdf_scratch_size = (size_t)w * h;
+    }
+
+    int stride = sdf->width + 2;
+    int max_u = ((sdf->width + 1) << 16) - 1;   /* 采样坐标上限，保证 iu + 1 不越过边框 */
+    int max_v = ((sdf->height + 1) << 16) - 1;
+    float inv = 1.0f / r;
+    int du = (int)(inv * 65536.0f);
+    int gain = (int)(r * 255.0f / SDF_DIST_SCALE * 256.0f);    /* 距离值到覆盖度的增益（8.8 定点数） */
+    int u_start = (int)(((x0 + 0.5f - left) * inv + 0.5f) * 65536.0f);   /* 距离场坐标含 1 像素边框 */
+    for (int j = 0; j < h; j++) {
+        int v = (int)(((y0 + j + 0.5f - top) * inv + 0.5f) * 65536.0f);
+        v = v < 0 ? 0 : (v > max_v ? max_v : v);
+        const unsigned char *row0 = sdf->field + (v >> 16) * stride;
+        const unsigned char *row1 = row0 + stride;
+        int fv = (v >> 8) & 0xFF;
+        unsigned char *out = sdf_scratch + j * w;
+        int u = u_start;
+        for (int i = 0; i < w; i++, u += du) {
+            int uc = u < 0 ? 0 : (u > max_u ? max_u : u);
+            int iu = uc >> 16, fu = (uc >> 8) & 0xFF;
+            int a = row0[iu] * 256 + (row0[iu + 1] - row0[iu]) * fu;     /* 上一行插值，8.8 定点数 */
+            int b = row1[iu] * 256 + (row1[iu + 1] - row1[iu]) * fu;     /* 下一行插值 */
+            int d = a + (((b - a) * fv) >> 8);
+            int c = (((d - SDF_ONEDGE * 256) * gain) >> 16) + 128;
+            out[i] = (unsigned char)(c < 0 ? 0 : (c > 255 ? 255 : c));
+        }
+    }
+    blend_coverage(sdf_scratch, w, h, x0, y0, color, x0, y0, x1, y1);
+}
+
+/* 最低的置位位序号，bits 不为 0 */
+static inline int bit_scan(uint32_t bits) {
+#if defined(__GNUC__)
+    return __builtin_ctz(bits);
+#else
+    int n = 0;
+    while (!(bits & 1)) {
+        bits >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/*
+* 1 位蒙版填充
+* mask：1 位蒙版，格式见 glyph_encode。
+* 逻辑：与 blend_coverage 相同地裁剪；每行逐个 32 位字先屏蔽 [i0, i1) 以外的位，
+*      再用位扫描跳过 0 位、求出连续 1 位的长度，整段写入前景色（A8 目标写入灰度），不读取目标像素。
+*/
+static void fill_mask_a1(const unsigned char *mask, int width, int height, int dst_x, int dst_y,
+                         color_t color, int clip_x0, int clip_y0, int clip_x1, int clip_y1) {
+    if (!clip_to_target(&clip_x0, &clip_y0, &clip_x1, &clip_y1)) return;
+    int i0 = clip_x0 > dst_x ? clip_x0 - dst_x : 0;
+    int j0 = clip_y0 > dst_y ? clip_y0 - dst_y : 0;
+    int i1 = clip_x1 < dst_x + width ? clip_x1 - dst_x : width;
+    int j1 = clip_y1 < dst_y + height ? clip_y1 - dst_y : height;
+    if (i0 >= i1 || j0 >= j1) return;
+
+    int words = (width + 31) >> 5;
+    int gray_target = target->format == LCD_FORMAT_A8;
+    unsigned int gray = color_to_gray(color);
+    for (int j = j0; j < j1; ++j) {
+        uint16_t *dst16 = gray_target ? NULL : surface_row16(target, dst_y + j) + dst_x;
+        uint8_t *dst8 = gray_target ? surface_row8(target, dst_y + j) + dst_x : NULL;
+        for (int w = i0 >> 5; w <= (i1 - 1) >> 5; w++) {
+            uint32_t bits;
+            memcpy(&bits, mask + (j * words + w) * 4, 4);
+            int base = w << 5;
+            if (base < i0) bits &= ~0u << (i0 - base);
+            if (i1 - base < 32) bits &= (1u << (i1 - base)) - 1;
+            while (bits) {
+                int start = bit_scan(bits);
+                uint32_t rest = ~(bits >> start);       /* 连续 1 位的长度 = rest 最低置位位序号 */
+                int run = rest ? bit_scan(rest) : 32 - start;
+                int x = base + start;
+                if (gray_target) {
+                    memset(dst8 + x, gray, run);
+                } else {
+                    for (int k = 0; k < run; k++) dst16[x + k] = color;
+                }
+                bits = run + start < 32 ? bits & (~0u << (start + run)) : 0;
+            }
+        }
+    }
+}
+
+/* 设置文字渲染方式 */
+void lcd_set_text_mode(lcd_text_mode_t mode) {
+    /* 数字精灵按渲染方式生成，切换到 LCD_TEXT_MONO 或从它切换回来时释放原来的精灵 */
+    if ((mode == LCD_TEXT_MONO) != (text_mode == LCD_TEXT_MONO)) number_cache_clear();
+    text_mode = mode;
+}
+
+/* 设置距离场缓存的字节预算 */
+void lcd_set_sdf_cache_budget(size_t bytes) {
+    sdf_cache.budget = bytes;
+    cache_trim(&sdf_cache, bytes);
+}
+
+/*
+* 渲染单个字形
+* key：字形键（字符码点或 GLYPH_KEY(字形索引)）。xpos：字符笔位 x 坐标（含亚像素部分）。
+* baseline_y：基线在屏幕上的 y 坐标。
+* size：字体大小。color：文字颜色。
+* clip_x0、clip_y0、clip_x1、clip_y1：裁剪矩形（右、下边界不含），字形只在该矩形与屏幕的交集内与背景混合。
+*/
+static void render_glyph(int key, float xpos, int baseline_y, int size, color_t color,
+                         int clip_x0, int clip_y0, int clip_x1, int clip_y1) {
+    if (text_mode == LCD_TEXT_SDF) {
+        render_glyph_sdf(key, xpos, baseline_y, size, color, clip_x0, clip_y0, clip_x1, clip_y1);
+        return;
+    }
+    int mono = text_mode == LCD_TEXT_MONO;
+    const GlyphEntry *glyph = glyph_cache_get(key, size, mono ? GLYPH_SUBPIXEL_MONO : glyph_subpixel(xpos));
+    if (!glyph || glyph->width == 0) return;   /* 空白字符没有位图 */
+
+    int x = (int)floor(xpos) + glyph->x0, y = baseline_y + glyph->y0;
+    if (glyph->format == GLYPH_FORMAT_A1) {
+        fill_mask_a1(glyph->bitmap, glyph->width, glyph->height, x, y, color, clip_x0, clip_y0, clip_x1, clip_y1);
+    } else if (glyph->format == LCD_GLYPH_A4) {
+        blend_coverage_a4(glyph->bitmap, glyph->width, glyph->height, x, y, color, clip_x0, clip_y0, clip_x1, clip_y1);
+    } else if (glyph->format == LCD_GLYPH_A4_RLE) {
+        blend_coverage_rle(glyph->bitmap, glyph->width, glyph->height, x, y, color, clip_x0, clip_y0, clip_x1, clip_y1);
+    } else {
+        blend_coverage(glyph->bitmap, glyph->width, glyph->height, x, y, color, clip_x0, clip_y0, clip_x1, clip_y1);
+    }
+}
+
+/*
+* 字符串缓存（二级缓存）
+* 以（输入形式，输入数据的字节串，字体大小，字体链）为键缓存整串文字合成后的覆盖度蒙版。蒙版与颜色无关，
+* 更换文字颜色不需要重新光栅化；重复渲染同一字符串只需一次蒙版混合。
+* 准入策略：字符串第一次出现时只在 text_seen 中记下它的哈希值，按字形逐个渲染；再次出现时才生成蒙版。
+* 时钟、计数器等每次都不同的字符串不生成蒙版，也不会挤掉静态标签的蒙版。
+*/
+#define TEXT_CACHE_BUCKETS          256             /* 字符串缓存哈希桶数量 */
+#define TEXT_SEEN_SIZE              512             /* 准入表大小（2 的幂） */
+#define TEXT_CACHE_DEFAULT_BUDGET   (256 * 1024)    /* 字符串缓存默认字节预算 */
+
+typedef struct {
+    CacheNode node;             /* 缓存节点，必须是第一个成员 */
+    int kind;                   /* 输入形式 */
+    int size;                   /* 字体大小 */
+    unsigned int fonts;         /* 生成蒙版时的字体链标识 */
+    int len;                    /* 输入数据字节数 */
+    int ox, oy;                 /* 蒙版左上角相对文本起始坐标 (x, y) 的偏移 */
+    int width, height;          /* 蒙版尺寸，没有可见字形时为 0 */
+    unsigned char *mask;        /* 覆盖度蒙版，紧跟在 text 之后 */
+    char text[];                /* 输入数据副本，用于确认命中 */
+} TextEntry;
+
+static Cache text_cache = { NULL, TEXT_CACHE_BUCKETS, NULL, NULL, 0, TEXT_CACHE_DEFAULT_BUDGET };
+static unsigned int text_seen[TEXT_SEEN_SIZE];  /* 只出现过一次的字符串的哈希值，按哈希值直接映射，冲突时覆盖 */
+
+/*
+* 生成字符串蒙版
+* 逻辑：第一遍按 lcd_render_text 的方式推进笔位，求出所有字形位图的包围盒；
+*      第二遍把每个字形的覆盖度合成到蒙版中。重叠处按 a + b - a*b/255 合成，
+*      与逐个字形依次混合到屏幕上的结果一致。字形均来自一级字形缓存。
+*/
+static TextEntry *text_entry_build(const TextSource *source, int size, unsigned int hash) {
+    int len = (int)text_source_bytes(source);
+    float scale = stbtt_ScaleForPixelHeight(font, size);
+    int ascent;
+    stbtt_GetFontVMetrics(font, &ascent, 0, 0);
+    int baseline = (int)(ascent * scale);
+
+    int min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+    int empty = 1;
+    for (int pass = 0; pass < 2; pass++) {
+        TextEntry *entry = NULL;
+        if (pass == 1) {
+            int width = empty ? 0 : max_x - min_x;
+            int height = empty ? 0 : max_y - min_y;
+            size_t bytes = sizeof(TextEntry) + len + (size_t)width * height;
+            if (bytes > text_cache.budget) return NULL;     /* 蒙版超出预算，不缓存 */
+            entry = (TextEntry*)malloc(bytes);
+            if (!entry) return NULL;
+            entry->node.hash = hash;
+            entry->node.bytes = bytes;
+            entry->kind = source->kind;
+            entry->size = size;
+            entry->fonts = chain_id();
+            entry->len = len;
+            entry->ox = min_x;
+            entry->oy = min_y;
+            entry->width = width;
+            entry->height = height;
+            memcpy(entry->text, source->data, len);
+            entry->mask = (unsigned char*)entry->text + len;
+            memset(entry->mask, 0, (size_t)width * height);
+            if (empty) return entry;
+        }
+
+        float xpos = 0;
+        TextSource src = *source;   /* 每一遍从头读取输入 */
+        int key, next_key = 0;
+        int more = text_next(&src, &key);
+        while (more) {
+            more = text_next(&src, &next_key);
+            if (!key_is_control(key)) {  /* 跳过 ASCII 码小于 32 的控制字符 */
+                const GlyphEntry *glyph = glyph_cache_get(key, size, glyph_subpixel(xpos));
+                if (glyph && glyph->width > 0) {
+                    int gx = (int)floor(xpos) + glyph->x0;
+                    int gy = baseline + glyph->y0;
+                    if (pass == 0) {
+                        if (empty || gx < min_x) min_x = gx;
+                        if (empty || gy < min_y) min_y = gy;
+                        if (empty || gx + glyph->width > max_x) max_x = gx + glyph->width;
+                        if (empty || gy + glyph->height > max_y) max_y = gy + glyph->height;
+                        empty = 0;
+                    } else {
+                        const unsigned char *coverage = glyph_coverage(glyph);
+                        for (int j = 0; coverage && j < glyph->height; j++) {
+                            const unsigned char *src = coverage + j * glyph->width;
+                            unsigned char *dst = entry->mask + (gy - min_y + j) * entry->width + (gx - min_x);
+                            for (int k = 0; k < glyph->width; k++) {
+                                dst[k] = (unsigned char)(dst[k] + src[k] - dst[k] * src[k] / 255);
+                            }
+                        }
+                    }
+                }
+
+                xpos += key_advance(key) * scale;
+                if (more) {
+                    xpos += scale * key_kern(key, next_key);
+                }
+            }
+            key = next_key;
+        }
+        if (pass == 1) return entry;
+    }
+    return NULL;
+}
+
+/* 查找（或生成）字符串蒙版，字符串第一次出现或无法缓存时返回 NULL */
+static const TextEntry *text_cache_get(const TextSource *src, int size) {
+    if (text_cache.budget == 0 || text_mode != LCD_TEXT_EXACT) return NULL;    /* 蒙版由精确光栅化的字形合成 */
+
+    int len = (int)text_source_bytes(src);
+    unsigned int fonts = chain_id();
+    int id[3] = { src->kind, size, (int)fonts };
+    unsigned int hash = hash_bytes(hash_bytes(2166136261u, id, sizeof(id)), src->data, len);
+    for (CacheNode *node = cache_bucket(&text_cache, hash); node; node = node->hash_next) {
+        TextEntry *entry = (TextEntry*)node;
+        if (node->hash == hash && entry->kind == src->kind && entry->size == size && entry->fonts == fonts &&
+            entry->len == len &&
+            memcmp(entry->text, src->data, len) == 0) {
+            cache_touch(&text_cache, node);
+            return entry;
+        }
+    }
+
+    unsigned int *seen = &text_seen[hash & (TEXT_SEEN_SIZE - 1)];
+    if (*seen != hash) {        /* 第一次出现：只记下哈希值，不生成蒙版 */
+        *seen = hash;
+        return NULL;
+    }
+    *seen = 0;
+    TextEntry *entry = text_entry_build(src, size, hash);
+    if (entry && cache_insert(&text_cache, &entry->node) != 0) {
+        free(entry);
+        return NULL;
+    }
+    return entry;
+}
+
+/* 设置缓存预算 */
+void lcd_set_cache_budget(size_t glyph_bytes, size_t text_bytes) {
+    /*
+    * 缩小预算时立即淘汰超出部分；预算为 0 时清空并禁用对应缓存。
+    */
+    glyph_cache.budget = glyph_bytes;
+    text_cache.budget = text_bytes;
+    cache_trim(&glyph_cache, glyph_bytes);
+    cache_trim(&text_cache, text_bytes);
+}
+
+/* 设置字形缓存的存储格式 */
+void lcd_set_glyph_format(lcd_glyph_format_t format) {
+    /*
+    * 已缓存的字形保持原格式，仍可正常使用；为使缓存占用与新格式一致，格式改变时清空字形缓存，
+    * 字符串蒙版由字形合成，一并清空。未知的格式被忽略，保持原格式。
+    */
+    if (format < LCD_GLYPH_A8 || format > LCD_GLYPH_A4_RLE) return;
+    if (format == glyph_format) return;
+    glyph_format = format;
+    cache_trim(&glyph_cache, 0);
+    cache_trim(&text_cache, 0);
+}
+
+/* 渲染输入源中的文字 */
+static void text_render(TextSource *src, int x, int y, color_t text_color, int font_size) {
+    /* 字符串缓存命中（或第二次出现且可以缓存）时，整串文字只需一次蒙版混合 */
+    const TextEntry *cached = text_cache_get(src, font_size);
+    if (cached) {
+        blend_coverage(cached->mask, cached->width, cached->height, x + cached->ox, y + cached->oy,
+                       text_color, 0, 0, target->width, target->height);
+        return;
+    }
+    
+    /* 边界检查与初始化 */
+    float scale = stbtt_ScaleForPixelHeight(font, font_size);  /* 根据当前字体和字体大小计算缩放比例 */
+    int ascent, baseline;
+    stbtt_GetFontVMetrics(font, &ascent, 0, 0);    /* 获取字体的垂直度量信息，ascent 表示基线以上的高度 */
+    baseline = (int)(ascent * scale);   /* 计算基线相对于起始 y 坐标的位置 */
+
+    float xpos = (float)x;      /* 初始化当前字符的 x 坐标 */
+
+    /*
+    * 输入源逐个给出字符的字形键，每个字符只解码一次：
+    * 取出的下一个字符 next_key 用于字距调整，随后成为当前字符 key
+    */
+    int key, next_key = 0;
+    int more = text_next(src, &key);
+    
+    /* 遍历文本 */
+    while (more) {
+        more = text_next(src, &next_key);
+        
+        if (key_is_control(key)) { /* 跳过 ASCII 码小于 32 的控制字符 */ 
+            key = next_key;
+            continue;
+        }
+
+        /* 生成字符位图并渲染，裁剪范围为整个绘制目标 */
+        render_glyph(key, xpos, y + baseline, font_size, text_color, 0, 0, target->width, target->height);
+
+        /* 更新 x 坐标并处理下一个字符 */
+        xpos += key_advance(key) * scale;   /* 更新 x 坐标，加上当前字符的前进宽度 */
+        if (more) {                 /* 若不是最后一个字符，计算并加上与下一个字符之间的字距调整值 */
+            xpos += scale * key_kern(key, next_key);
+        }
+        
+        key = next_key;     /* 处理下一个字符 */
+    }
+}
+
+/* 渲染文字 */
+void lcd_render_text(const char *text, int x, int y, color_t text_color, int font_size) {
+    if (!text || !lcd) return;
+    lcd_render_text_n(text, strlen(text), x, y, text_color, font_size);
+}
+
+/* 渲染长度为 len 字节的文字 */
+void lcd_render_text_n(const char *text, int len, int x, int y, color_t text_color, int font_size) {
+    if (!text || !lcd) return;
+    TextSource src;
+    text_source_init(&src, TEXT_UTF8, text, len);
+    text_render(&src, x, y, text_color, font_size);
+}
+
+/* 渲染码点数组 */
+void lcd_render_text_u32(const uint32_t *codepoints, int count, int x, int y, color_t text_color, int font_size) {
+    if (!codepoints || !lcd) return;
+    TextSource src;
+    text_source_init(&src, TEXT_UTF32, codepoints, count);
+    text_render(&src, x, y, text_color, font_size);
+}
+
+/* 渲染字形索引数组 */
+void lcd_render_glyphs(const uint16_t *glyphs, int count, int x, int y, color_t text_color, int font_size) {
+    if (!glyphs || !lcd) return;
+    TextSource src;
+    text_source_init(&src, TEXT_GLYPH, glyphs, count);
+    text_render(&src, x, y, text_color, font_size);
+}
+
+/* 渲染输入源中的文字（带文本框） */
+static void text_render_with_box(const TextSource *source, int x, int y, color_t text_color, 
+                                 color_t box_color, int padding, BoxStyle style, int radius, int font_size,
+                                 int box_width, int box_height) {
+    /* 
+    * source：要渲染的文本输入源。
+    * x、y：文本渲染起始位置的坐标。
+    * text_color：文本的颜色。
+    * box_color：文本框的填充颜色。
+    * padding：文本与文本框边缘的间距。
+    * style：文本框的样式，类型为 BoxStyle，可能是矩形或圆角矩形。
+    * radius：若 style 为圆角矩形，该参数指定圆角的半径。 
+    * font_size：文本的字体大小。
+    * box_width：文本框的宽度（长），为 0 时，根据文本量与字体大小调整，文字居中对齐。
+    * box_height：文本框的高度（宽），为 0 时，根据文本量与字体大小调整，文字居中对齐。
+    */
+    TextSource src;
+
+    /* 设置字体大小 */ 
+    lcd_set_font_size(font_size);
+
+    /* 如果 box_width 或 box_height 为 0，则根据文本内容计算文本框大小 */
+    if (box_width == 0 || box_height == 0) {
+        src = *source;
+        box_width = text_width(&src) + 2 * padding;
+        box_height = lcd_get_text_height() + 2 * padding;
+    }
+
+    /* 
+    * 绘制文本框
+    * 若 style 为 BOX_STYLE_RECTANGLE，调用 lcd_draw_filled_rectangle 函数绘制填充矩形文本框。
+    * 矩形左上角坐标为 (x - padding, y - padding)，宽度为 box_width，
+    * 高度为 box_height，颜色为 box_color。
+    *
+    * 若 style 不是 BOX_STYLE_RECTANGLE，调用 lcd_draw_filled_rounded_rectangle 函数绘制
+    * 填充圆角矩形文本框，参数含义与矩形类似，额外传入圆角半径 radius。
+    */ 
+    if (style == BOX_STYLE_RECTANGLE) {
+        lcd_draw_filled_rectangle(x - padding, y - padding, box_width, box_height, box_color);
+    } else {
+        lcd_draw_filled_rounded_rectangle(x - padding, y - padding, box_width, box_height, radius, box_color);
+    }
+    
+    /* 
+    * 绘制文字
+    * 在指定位置 (x, y) 以 text_color 颜色渲染文本
+    */ 
+    src = *source;
+    text_render(&src, x, y, text_color, font_size);
+}
+
+/* 渲染文字（带文本框） */
+void lcd_render_text_with_box(const char *text, int x, int y, color_t text_color, 
+                              color_t box_color, int padding, BoxStyle style, int radius, int font_size,
+                              int box_width, int box_height) {
+    if (!text || !lcd) return;
+    lcd_render_text_with_box_n(text, strlen(text), x, y, text_color, box_color, padding, style, radius,
+                               font_size, box_width, box_height);
+}
+
+/* 渲染长度为 len 字节的文字（带文本框） */
+void lcd_render_text_with_box_n(const char *text, int len, int x, int y, color_t text_color, 
+                                color_t box_color, int padding, BoxStyle style, int radius, int font_size,
+                                int box_width, int box_height) {
+    if (!text || !lcd) return;
+    TextSource src;
+    text_source_init(&src, TEXT_UTF8, text, len);
+    text_render_with_box(&src, x, y, text_color, box_color, padding, style, radius,
+                         font_size, box_width, box_height);
+}
+
+/* 渲染码点数组（带文本框） */
+void lcd_render_text_with_box_u32(const uint32_t *codepoints, int count, int x, int y, color_t text_color, 
+                                  color_t box_color, int padding, BoxStyle style, int radius, int font_size,
+                                  int box_width, int box_height) {
+    if (!codepoints || !lcd) return;
+    TextSource src;
+    text_source_init(&src, TEXT_UTF32, codepoints, count);
+    text_render_with_box(&src, x, y, text_color, box_color, padding, style, radius,
+                         font_size, box_width, box_height);
+}
+
+/* 文本槽中的单个字符单元 */
+typedef struct {
+    int key;        /* 字形键 */
+    float xpos;     /* 字符笔位，相对文本槽左边界（含亚像素部分） */
+    int left;       /* 单元占用的左边界列（字形墨迹与前进宽度的并集），相对文本槽左边界 */
+    int right;      /* 单元占用的右边界列（不含） */
+} SlotCell;
+
+/* 文本槽：保存上一次字符串的排版结果，更新时只重绘发生变化的字符单元 */
+struct lcd_text_slot {
+    int x, y;               /* 文本槽左上角坐标 */
+    int max_width;          /* 最大宽度，超出部分被裁剪 */
+    int height;             /* 文本槽高度，由字体大小决定 */
+    int font_size;          /* 字体大小 */
+    float scale;            /* 字体缩放比例 */
+    int baseline;           /* 基线相对文本槽上边界的偏移 */
+    color_t text_color;     /* 文本颜色 */
+    color_t bg_color;       /* 背景颜色，重绘单元时先用该颜色清除 */
+    SlotCell *cells;        /* 当前显示内容的字符单元 */
+    SlotCell *next;         /* 新字符串的排版结果，更新完成后与 cells 交换 */
+    int count;              /* 当前字符单元数量 */
+    int capacity;           /* 两个单元数组的容量 */
+    unsigned char *dirty;   /* 每列一个标记，记录本次更新需要重绘的列 */
+    int valid;              /* 为 0 时表示屏幕内容不可信，下一次更新整体重绘 */
+};
+
+/* 创建文本槽 */
+lcd_text_slot_t *lcd_text_slot_create(int x, int y, int max_width, int font_size,
+                                      color_t text_color, color_t bg_color) {
+    if (!lcd || max_width <= 0) return NULL;
+
+    lcd_text_slot_t *slot = (lcd_text_slot_t*)calloc(1, sizeof(lcd_text_slot_t));
+    if (!slot) {
+        perror("malloc");
+        return NULL;
+    }
+    slot->dirty = (unsigned char*)malloc(max_width);
+    if (!slot->dirty) {
+        perror("malloc");
+        free(slot);
+        return NULL;
+    }
+
+    /* 计算缩放比例与基线，字体大小在文本槽生命周期内保持不变 */
+    int ascent, descent;
+    stbtt_GetFontVMetrics(font, &ascent, &descent, 0);
+    slot->scale = stbtt_ScaleForPixelHeight(font, font_size);
+    slot->baseline = (int)(ascent * slot->scale);
+    slot->height = (int)((ascent - descent) * slot->scale);
+
+    slot->x = x;
+    slot->y = y;
+    slot->max_width = max_width;
+    slot->font_size = font_size;
+    slot->text_color = text_color;
+    slot->bg_color = bg_color;
+    return slot;
+}
+
+/* 销毁文本槽，不改变屏幕内容 */
+void lcd_text_slot_destroy(lcd_text_slot_t *slot) {
+    if (slot) {
+        free(slot->cells);
+        free(slot->next);
+        free(slot->dirty);
+        free(slot);
+    }
+}
+
+/* 屏幕被其他绘制覆盖后调用，下一次更新时整体重绘文本槽 */
+void lcd_text_slot_invalidate(lcd_text_slot_t *slot) {
+    if (slot) slot->valid = 0;
+}
+
+/*
+* 标记需要重绘的列
+* 将单元占用的列区间 [left, right) 裁剪到文本槽宽度内后置为脏。
+*/
+static void slot_mark_dirty(lcd_text_slot_t *slot, const SlotCell *cell) {
+    int left = cell->left < 0 ? 0 : cell->left;
+    int right = cell->right > slot->max_width ? slot->max_width : cell->right;
+    if (left < right) {
+        memset(slot->dirty + left, 1, right - left);
+    }
+}
+
+/*
+* 排版新字符串
+* 逻辑：与 lcd_render_text 相同的方式推进笔位（前进宽度加字距调整），
+*      同时记录每个字符的码点、笔位以及它在屏幕上占用的列范围。
+*/
+static int slot_layout(lcd_text_slot_t *slot, const char *text, int len) {
+    float xpos = 0;
+    int n = 0;
+    TextSource src;
+    int key, next_key = 0;
+    text_source_init(&src, TEXT_UTF8, text, len);
+    int more = text_next(&src, &key);
+
+    while (more) {
+        more = text_next(&src, &next_key);
+
+        if (!key_is_control(key)) {  /* 跳过 ASCII 码小于 32 的控制字符 */
+            int x0, y0, x1, y1;
+            float x_shift = text_mode == LCD_TEXT_MONO ? 0 :          /* 与字形缓存相同的亚像素档位 */
+                            (float)glyph_subpixel(xpos) / GLYPH_SUBPIXEL_STEPS;
+            float advance = key_advance(key);
+            key_bitmap_box(key, slot->scale, x_shift, &x0, &y0, &x1, &y1);
+
+            SlotCell *cell = &slot->next[n++];
+            int pen = (int)floor(xpos);
+            int end = (int)ceil(xpos + advance * slot->scale);
+            cell->key = key;
+            cell->xpos = xpos;
+            cell->left = (x1 > x0 && pen + x0 < pen) ? pen + x0 : pen;
+            cell->right = (x1 > x0 && pen + x1 > end) ? pen + x1 : end;
+
+            xpos += (advance * slot->scale);
+            if (more) {
+                xpos += slot->scale * key_kern(key, next_key);
+            }
+        }
+        key = next_key;
+    }
+    return n;
+}
+
+/*
+* 更新文本槽内容
+* 逻辑：先对新字符串排版，与上一次的排版结果逐个单元比较，码点或笔位不同的单元
+*      （包括新增和删除的单元）将其新旧两次占用的列都标记为脏。随后对每段连续的
+*      脏列：先用背景色清除，再把与该段相交的新字形裁剪到该段内重新渲染。
+*      未变化的单元不产生任何像素写入。
+*/
+void lcd_text_slot_update(lcd_text_slot_t *slot, const char *text) {
+    if (!slot || !text || !lcd) return;
+    lcd_text_slot_update_n(slot, text, strlen(text));
+}
+
+/* 以长度为 len 字节的字符串更新文本槽 */
+void lcd_text_slot_update_n(lcd_text_slot_t *slot, const char *text, int len) {
+    if (!slot || !text || !lcd || len < 0) return;
+
+    /* 字符数不会超过字节数，按字节数保证单元数组容量 */
+    if (len > slot->capacity) {
+        SlotCell *cells = (SlotCell*)realloc(slot->cells, len * sizeof(SlotCell));
+        if (!cells) return;
+        slot->cells = cells;
+        SlotCell *next = (SlotCell*)realloc(slot->next, len * sizeof(SlotCell));
+        if (!next) return;
+        slot->next = next;
+        slot->capacity = len;
+    }
+
+    int n = slot_layout(slot, text, len);
+
+    /* 比较新旧排版，标记脏列 */
+    if (!slot->valid) {
+        memset(slot->dirty, 1, slot->max_width);
+    } else {
+        memset(slot->dirty, 0, slot->max_width);
+        int common = n < slot->count ? n : slot->count;
+        for (int k = 0; k < common; k++) {
+            if (slot->cells[k].key != slot->next[k].key ||
+                slot->cells[k].xpos != slot->next[k].xpos) {
+                slot_mark_dirty(slot, &slot->cells[k]);
+                slot_mark_dirty(slot, &slot->next[k]);
+            }
+        }
+        for (int k = common; k < slot->count; k++) slot_mark_dirty(slot, &slot->cells[k]);
+        for (int k = common; k < n; k++) slot_mark_dirty(slot, &slot->next[k]);
+    }
+
+    /* 逐段重绘连续的脏列 */
+    int clip_y0 = slot->y;
+    int clip_y1 = slot->y + slot->height;
+    int col = 0;
+    while (col < slot->max_width) {
+        if (!slot->dirty[col]) {
+            col++;
+            continue;
+        }
+        int start = col;
+        while (col < slot->max_width && slot->dirty[col]) col++;
+
+        lcd_draw_filled_rectangle(slot->x + start, slot->y, col - start, slot->height, slot->bg_color);
+        for (int k = 0; k < n; k++) {
+            const SlotCell *cell = &slot->next[k];
+            if (cell->right > start && cell->left < col) {
+                render_glyph(cell->key, slot->x + cell->xpos, slot->y + slot->baseline, slot->font_size,
+                             slot->text_color, slot->x + start, clip_y0, slot->x + col, clip_y1);
+            }
+        }
+    }
+
+    /* 交换新旧排版结果 */
+    SlotCell *tmp = slot->cells;
+    slot->cells = slot->next;
+    slot->next = tmp;
+    slot->count = n;
+    slot->valid = 1;
+}
+
+/*
+* 数字精灵缓存
+* 数值显示几乎只用到 0~9 以及 . - : 和空格。对给定的（字体大小，前景色，背景色）组合，
+* 预先把这些字形与背景混合成完整的 RGB565 像素块（精灵），绘制数字时只需逐行 memcpy。
+* 数字与空格使用相同的等宽（取数字前进宽度的最大值），便于右对齐的数值刷新时位置不变。
+* LCD_TEXT_MONO 方式下精灵由 1 位蒙版字形生成，只含前景色与背景色；LCD_TEXT_SDF 方式下仍使用精确光栅化的精灵。
+*/
+#define NUMBER_GLYPH_COUNT  14      /* 精灵数量：10 个数字 + . - : 空格 */
+#define NUMBER_CACHE_SIZE   8       /* 同时缓存的（字体，字体大小，颜色）组合数量 */
+
+/* 一组数字精灵 */
+typedef struct {
+    unsigned int fonts;                     /* 生成精灵时的字体链标识 */
+    int font_size;                          /* 字体大小 */
+    color_t fg;                             /* 前景色 */
+    color_t bg;                             /* 背景色 */
+    int mono;                               /* 是否由 1 位蒙版字形生成 */
+    int height;                             /* 精灵高度，等于文本高度 */
+    int width[NUMBER_GLYPH_COUNT];          /* 每个精灵的宽度 */
+    uint16_t *pixels[NUMBER_GLYPH_COUNT];   /* 每个精灵的像素，指向 buffer 内部 */
+    uint16_t *buffer;                       /* 所有精灵共用的像素缓冲区，为 NULL 表示该项空闲 */
+    unsigned int last_used;                 /* 最近使用时刻，用于淘汰最久未用的组合 */
+} NumberSprites;
+
+static NumberSprites number_cache[NUMBER_CACHE_SIZE];
+static unsigned int number_tick = 0;
+
+/* 字符到精灵序号的映射，不在精灵集合中的字符返回 -1 */
+static int number_glyph_index(int c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    switch (c) {
+        case '.': return 10;
+        case '-': return 11;
+        case ':': return 12;
+        case ' ': return 13;
+        default:  return -1;
+    }
+}
+
+/* 释放全部数字精灵 */
+static void number_cache_clear(void) {
+    for (int k = 0; k < NUMBER_CACHE_SIZE; k++) {
+        free(number_cache[k].buffer);
+        number_cache[k].buffer = NULL;
+    }
+}
+
+/* 释放所有依赖当前字体的缓存 */
+static void font_caches_clear(void) {
+    cache_clear(&glyph_cache);
+    cache_clear(&text_cache);
+    memset(text_seen, 0, sizeof(text_seen));
+    cache_clear(&sdf_cache);
+    cache_clear(&outline_cache);
+    free(glyph_uncached);
+    glyph_uncached = NULL;
+    free(sdf_uncached);
+    sdf_uncached = NULL;
+    free(outline_uncached);
+    outline_uncached = NULL;
+    free(glyph_scratch);
+    glyph_scratch = NULL;
+    glyph_scratch_size = 0;
+    free(sdf_scratch);
+    sdf_scratch = NULL;
+    sdf_scratch_size = 0;
+    number_cache_clear();
+}
+
+/*
+* 释放某个字体的缓存
+* 逻辑：字形缓存中移除字形键属于该字体的项；字符串缓存中移除以该字体为主字体生成的蒙版；
+*      距离场缓存与轮廓缓存中移除该字体的字形；数字精灵中释放该字体生成的组合。其他字体的缓存保持不变。
+*/
+static void font_caches_drop(int face) {
+    CacheNode *next;
+    for (CacheNode *node = glyph_cache.head; node; node = next) {
+        next = node->next;
+        if (key_face(((GlyphEntry*)node)->key) == &faces[face]) cache_remove(&glyph_cache, node);
+    }
+    for (CacheNode *node = text_cache.head; node; node = next) {
+        next = node->next;
+        if (((TextEntry*)node)->fonts % FONT_MAX == (unsigned int)face) cache_remove(&text_cache, node);
+    }
+    for (CacheNode *node = sdf_cache.head; node; node = next) {
+        next = node->next;
+        if (key_face(((SdfEntry*)node)->key) == &faces[face]) cache_remove(&sdf_cache, node);
+    }
+    for (CacheNode *node = outline_cache.head; node; node = next) {
+        next = node->next;
+        if (((OutlineEntry*)node)->id >> KEY_GLYPH_SHIFT == face) cache_remove(&outline_cache, node);
+    }
+    free(glyph_uncached);
+    glyph_uncached = NULL;
+    free(sdf_uncached);
+    sdf_uncached = NULL;
+    free(outline_uncached);
+    outline_uncached = NULL;
+    for (int k = 0; k < NUMBER_CACHE_SIZE; k++) {
+        if (number_cache[k].fonts % FONT_MAX == (unsigned int)face) {
+            free(number_cache[k].buffer);
+            number_cache[k].buffer = NULL;
+        }
+    }
+}
+
+/*
+* 生成一组数字精灵
+* 逻辑：先计算每个精灵的宽度（数字和空格取等宽，其余按自身前进宽度向上取整），
+*      一次分配全部像素；每个精灵先用背景色填满，再把字形居中放置并按覆盖度与背景混合。
+*      字符经 font_key 在字体链中查找，字形取自字形缓存，主字体缺少数字时与 lcd_render_text 一样使用后备字体。
+*/
+static int number_sprites_build(NumberSprites *set, int size, color_t fg, color_t bg) {
+    static const char glyphs[NUMBER_GLYPH_COUNT] = {
+        '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '.', '-', ':', ' '
+    };
+    float scale = stbtt_ScaleForPixelHeight(font, size);
+    int ascent, descent;
+    stbtt_GetFontVMetrics(font, &ascent, &descent, 0);
+    int baseline = (int)(ascent * scale);
+    int height = (int)((ascent - descent) * scale);
+    if (height <= 0) return -1;
+
+    int mono = text_mode == LCD_TEXT_MONO;
+
+    /* 数字等宽：取十个数字前进宽度的最大值 */
+    int keys[NUMBER_GLYPH_COUNT];
+    float advance_px[NUMBER_GLYPH_COUNT];
+    float tabular = 0;
+    for (int k = 0; k < NUMBER_GLYPH_COUNT; k++) {
+        keys[k] = font_key(glyphs[k]);
+        advance_px[k] = key_advance(keys[k]) * scale;
+        if (k < 10 && advance_px[k] > tabular) tabular = advance_px[k];
+    }
+
+    size_t total = 0;
+    for (int k = 0; k < NUMBER_GLYPH_COUNT; k++) {
+        set->width[k] = (k < 10 || glyphs[k] == ' ') ? (int)ceil(tabular) : (int)ceil(advance_px[k]);
+        total += (size_t)set->width[k] * height;
+    }
+    uint16_t *buffer = (uint16_t*)malloc(total * sizeof(uint16_t));
+    if (!buffer) {
+        perror("malloc");
+        return -1;
+    }
+
+    uint16_t *p = buffer;
+    for (int k = 0; k < NUMBER_GLYPH_COUNT; k++) {
+        int w = set->width[k];
+        set->pixels[k] = p;
+        for (int n = 0; n < w * height; n++) p[n] = bg;
+
+        /* 字形在精灵内水平居中 */
+        float pen = (w - advance_px[k]) / 2;
+        const GlyphEntry *glyph = glyph_cache_get(keys[k], size, mono ? GLYPH_SUBPIXEL_MONO : glyph_subpixel(pen));
+        const unsigned char *bitmap = glyph && glyph->width > 0 ? glyph_coverage(glyph) : NULL;
+        if (bitmap) {
+            int gw = glyph->width;
+            int gx = (int)floor(pen) + glyph->x0;
+            int gy = baseline + glyph->y0;
+            for (int j = 0; j < glyph->height; j++) {
+                if (gy + j < 0 || gy + j >= height) continue;
+                for (int i = 0; i < gw; i++) {
+                    unsigned char alpha = bitmap[j * gw + i];
+                    if (alpha > 0 && gx + i >= 0 && gx + i < w) {
+                        p[(gy + j) * w + gx + i] = blend_rgb565(bg, fg, alpha);
+                    }
+                }
+            }
+        }
+        p += w * height;
+    }
+
+    set->fonts = chain_id();
+    set->font_size = size;
+    set->fg = fg;
+    set->bg = bg;
+    set->mono = mono;
+    set->height = height;
+    set->buffer = buffer;
+    return 0;
+}
+
+/* 查找（或生成）指定组合的数字精灵，缓存满时淘汰最久未用的一组 */
+static NumberSprites *number_sprites_get(int size, color_t fg, color_t bg) {
+    NumberSprites *victim = &number_cache[0];
+    int mono = text_mode == LCD_TEXT_MONO;
+    for (int k = 0; k < NUMBER_CACHE_SIZE; k++) {
+        NumberSprites *set = &number_cache[k];
+        if (set->buffer && set->fonts == chain_id() && set->font_size == size && set->fg == fg && set->bg == bg &&
+            set->mono == mono) {
+            set->last_used = ++number_tick;
+            return set;
+        }
+        if (!set->buffer || (victim->buffer && set->last_used < victim->last_used)) {
+            victim = set;
+        }
+    }
+
+    free(victim->buffer);
+    victim->buffer = NULL;
+    if (number_sprites_build(victim, size, fg, bg) != 0) return NULL;
+    victim->last_used = ++number_tick;
+    return victim;
+}
+
+/*
+* 渲染数字
+* 逻辑：精灵集合内的字符按行 memcpy 预合成的像素，不做任何混合；左右或上下超出
+*      屏幕的部分只复制可见的行段。其他字符先用背景色填充其前进宽度，再普通渲染。
+*/
+void lcd_render_number(const char *text, int x, int y, color_t text_color, color_t bg_color, int font_size) {
+    if (!text || !lcd) return;
+    lcd_render_number_n(text, strlen(text), x, y, text_color, bg_color, font_size);
+}
+
+/* 渲染长度为 len 字节的数字文本 */
+void lcd_render_number_n(const char *text, int len, int x, int y, color_t text_color, color_t bg_color,
+                         int font_size) {
+    if (!text || !lcd || len < 0) return;
+
+    NumberSprites *set = number_sprites_get(font_size, text_color, bg_color);
+    if (!set) return;
+
+    float scale = stbtt_ScaleForPixelHeight(font, font_size);
+    int ascent;
+    stbtt_GetFontVMetrics(font, &ascent, 0, 0);
+    int baseline = (int)(ascent * scale);   /* 非数字字符按普通文本的基线渲染 */
+
+    int pen = x;
+    Utf8Reader reader;
+    int codepoint;
+    utf8_reader_init(&reader, text, len);
+    while (utf8_next(&reader, &codepoint) >= 0) {
+        if (codepoint < 32) continue;   /* 跳过控制字符 */
+
+        int k = number_glyph_index(codepoint);
+        if (k < 0) {
+            /* 非数字字符：填充背景后普通渲染 */
+            int key = font_key(codepoint);
+            int w = (int)ceil(key_advance(key) * scale);
+            lcd_draw_filled_rectangle(pen, y, w, set->height, bg_color);
+            render_glyph(key, (float)pen, y + baseline, font_size, text_color, pen, y, pen + w, y + set->height);
+            pen += w;
+            continue;
+        }
+
+        /* 与当前裁剪矩形及绘制目标求交后逐行复制精灵像素，A8 目标逐像素转换为灰度 */
+        int w = set->width[k];
+        int cx0 = pen, cy0 = y, cx1 = pen + w, cy1 = y + set->height;
+        if (clip_to_target(&cx0, &cy0, &cx1, &cy1)) {
+            int i0 = cx0 - pen, i1 = cx1 - pen;
+            int j0 = cy0 - y, j1 = cy1 - y;
+            const uint16_t *src = set->pixels[k];
+            for (int j = j0; j < j1; j++) {
+                if (target->format == LCD_FORMAT_A8) {
+                    uint8_t *dst = surface_row8(target, y + j) + pen;
+                    for (int i = i0; i < i1; i++) dst[i] = color_to_gray(src[j * w + i]);
+                } else {
+                    memcpy(surface_row16(target, y + j) + pen + i0, src + j * w + i0, (i1 - i0) * sizeof(uint16_t));
+                }
+            }
+        }
+        pen += w;
+    }
+}
+
+/*
+* 字体热切换
+* 后台线程读取并解析新字体，再按预热文本光栅化字形；渲染仍在调用者的线程中使用原来的字体，屏幕不会空白。
+* 应用在两帧之间调用 lcd_font_swap_poll：加载完成时把预热的字形并入字形缓存并切换主字体，
+* 下一次调用时（上一帧的绘制都已结束）再释放原来的字体及其缓存。同一时刻只有一个切换任务。
+* 后台线程只访问任务结构体、文件内容和字体信息，不接触缓存与字体链，因此不需要加锁。
+*/
+typedef struct {
+    int active;                 /* 有切换任务（后台线程已启动，尚未合并结果） */
+    pthread_t thread;           /* 后台线程 */
+    pthread_mutex_t lock;       /* 保护 done */
+    int done;                   /* 后台线程已结束 */
+    lcd_font_t *face;           /* 要切换到的字体，任务持有它的一个引用 */
+    lcd_font_t parsed;          /* 后台线程解析的结果（字体尚未解析时） */
+    int file;                   /* 已读取的文件在 font_files 中的序号，-1 表示由后台线程读取 */
+    unsigned char *data;        /* 字体文件内容 */
+    int result;                 /* 0 成功，-1 失败 */
+    char *text;                 /* 预热文本副本 */
+    int size;                   /* 预热字体大小 */
+    int format;                 /* 预热字形的存储格式 */
+    GlyphEntry **glyphs;        /* 预热得到的字形，尚未插入缓存 */
+    int glyph_count;            /* 预热字形数量 */
+    lcd_font_t *retired;        /* 已被换下、等待下一次 lcd_font_swap_poll 释放的字体 */
+} FontSwap;
+
+static FontSwap font_swap = { 0, 0, PTHREAD_MUTEX_INITIALIZER, 0, NULL, { 0 }, -1, NULL, 0, NULL, 0, 0, NULL, 0, NULL };
+
+/*
+* 后台加载
+* 逻辑：字体尚未解析时读取文件（主线程已读取过的文件直接使用其内容）并解析到 parsed；
+*      然后解码预热文本，对新字体包含的每个不重复码点按全部亚像素档位光栅化，结果暂存在 glyphs 中。
+*/
+static void *font_swap_thread(void *arg) {
+    FontSwap *job = (FontSwap*)arg;
+    const stbtt_fontinfo *info = &job->face->info;
+    const uint32_t *coverage = job->face->coverage;
+    int face = (int)(job->face - faces);
+
+    job->result = 0;
+    if (job->parsed.path) {       /* 字体尚未解析 */
+        if (!job->data) job->data = font_file_read(job->parsed.path);
+        if (!job->data || face_init(&job->parsed, job->data) != 0) job->result = -1;
+        info = &job->parsed.info;
+        coverage = job->parsed.coverage;
+    }
+
+    if (job->result == 0 && job->text) {
+        float scale = stbtt_ScaleForPixelHeight(info, job->size);
+        uint32_t *seen = (uint32_t*)calloc(0x110000 / 32, sizeof(uint32_t));   /* 已预热的码点 */
+        int capacity = 0;
+        Utf8Reader reader;
+        utf8_reader_init(&reader, job->text, (int)strlen(job->text));
+        int codepoint;
+        while (seen && utf8_next(&reader, &codepoint) >= 0) {
+            if (codepoint < 32 || ((seen[codepoint >> 5] >> (codepoint & 31)) & 1)) continue;
+            seen[codepoint >> 5] |= 1u << (codepoint & 31);
+            int covered = codepoint < 0x10000 ? (coverage[codepoint >> 5] >> (codepoint & 31)) & 1
+                                              : stbtt_FindGlyphIndex(info, codepoint) != 0;
+            if (!covered) continue;     /* 由后备字体显示的字符在使用时再光栅化 */
+
+            int glyph = stbtt_FindGlyphIndex(info, codepoint);
+            int key = codepoint | (face << KEY_FACE_SHIFT);
+            for (int subpixel = 0; subpixel < GLYPH_SUBPIXEL_STEPS; subpixel++) {
+                if (job->glyph_count == capacity) {
+                    int grown = capacity ? capacity * 2 : 64;
+                    GlyphEntry **glyphs = (GlyphEntry**)realloc(job->glyphs, grown * sizeof(GlyphEntry*));
+                    if (!glyphs) break;
+                    job->glyphs = glyphs;
+                    capacity = grown;
+                }
+                GlyphEntry *entry = glyph_rasterize(info, glyph, NULL, scale, key, job->size, subpixel, job->format);
+                if (entry) job->glyphs[job->glyph_count++] = entry;
+            }
+        }
+        free(seen);
+    }
+
+    pthread_mutex_lock(&job->lock);
+    job->done = 1;
+    pthread_mutex_unlock(&job->lock);
+    return NULL;
+}
+
+/* 释放切换任务的结果，任务回到空闲状态 */
+static void font_swap_finish(FontSwap *job) {
+    for (int i = 0; i < job->glyph_count; i++) free(job->glyphs[i]);
+    free(job->glyphs);
+    free(job->text);
+    free(job->parsed.coverage);
+    if (job->file < 0) free(job->data);
+    else font_file_close(job->file);
+    lcd_font_t *face = job->face;
+    if (face->state == FONT_LOADING) face->state = FONT_UNLOADED;
+    memset(&job->parsed, 0, sizeof(lcd_font_t));
+    job->face = NULL;
+    job->file = -1;
+    job->data = NULL;
+    job->text = NULL;
+    job->glyphs = NULL;
+    job->glyph_count = 0;
+    job->done = 0;
+    job->active = 0;
+    face_unref(face);
+}
+
+/* 释放已被换下的字体 */
+static void font_swap_retire(void) {
+    if (font_swap.retired) {
+        face_unref(font_swap.retired);
+        font_swap.retired = NULL;
+    }
+}
+
+/* 等待后台线程结束并丢弃切换任务（lcd_cleanup 时调用） */
+static void font_swap_cancel(void) {
+    if (font_swap.active) {
+        pthread_join(font_swap.thread, NULL);
+        font_swap_finish(&font_swap);
+    }
+    font_swap_retire();
+}
+
+/* 开始切换字体 */
+int lcd_font_swap(lcd_font_t *face, const char *prewarm_text, int font_size) {
+    /*
+    * 功能：在后台线程中加载字体并预热字形缓存，完成后由 lcd_font_swap_poll 切换为主字体。
+    * 逻辑：任务持有字体的一个引用；字体尚未解析时标记为 FONT_LOADING，期间不能被选用或作为后备字体查找。
+    *      同一文件已被其他字体读取时增加其使用计数，后台线程直接使用该文件内容。
+    */
+    FontSwap *job = &font_swap;
+    if (!lcd || !face || !face->path || job->active || font_size <= 0) return -1;
+    if (face->state == FONT_FAILED) return -1;
+
+    job->face = face;
+    job->size = font_size;
+    job->format = glyph_format;
+    job->text = prewarm_text ? strdup(prewarm_text) : NULL;
+    job->file = -1;
+    job->data = NULL;
+    if (face->state == FONT_UNLOADED) {
+        job->file = font_file_find(face->path);
+        if (job->file >= 0) {
+            font_files[job->file].refs++;
+            job->data = font_files[job->file].data;
+        }
+        job->parsed.path = face->path;
+        job->parsed.index = face->index;
+        face->state = FONT_LOADING;
+    }
+    face->refs++;
+    job->done = 0;
+    job->active = 1;
+    if (pthread_create(&job->thread, NULL, font_swap_thread, job) != 0) {
+        perror("pthread_create");
+        font_swap_finish(job);
+        return -1;
+    }
+    return 0;
+}
+
+/* 在两帧之间检查并完成字体切换 */
+int lcd_font_swap_poll(void) {
+    /*
+    * 功能：后台加载未完成时立即返回 0；完成时切换主字体并返回 1，加载失败返回 -1 并保持原来的字体。
+    * 逻辑：先释放上一次切换换下的字体；合并时把解析结果移交给字体，预热字形中缓存里还没有的项插入缓存，
+    *      再选用新字体。原来的主字体多持有一个引用，留到下一次调用时释放。
+    */
+    FontSwap *job = &font_swap;
+    font_swap_retire();
+    if (!job->active) return 0;
+
+    pthread_mutex_lock(&job->lock);
+    int done = job->done;
+    pthread_mutex_unlock(&job->lock);
+    if (!done) return 0;
+    pthread_join(job->thread, NULL);
+
+    lcd_font_t *face = job->face;
+    if (job->result != 0) {
+        if (face->state == FONT_LOADING) face->state = FONT_FAILED;
+        font_swap_finish(job);
+        return -1;
+    }
+
+    /*
+    * 移交解析结果：后台线程读取的文件内容登记到 font_files，开始时增加的使用计数转给字体。
+    * 加载期间同一文件已被其他字体读取时改用已登记的内容，字体信息重新指向它，释放本次读取的副本。
+    */
+    if (face->state == FONT_LOADING) {
+        if (job->file < 0) {
+            int file = font_file_find(face->path);
+            if (file >= 0) {
+                free(job->data);
+                if (!stbtt_InitFont(&job->parsed.info, font_files[file].data, job->parsed.info.fontstart)) file = -1;
+            } else {
+                file = font_file_add(face->path, job->data);
+            }
+            job->file = file;
+            job->data = NULL;       /* 已归 font_files 所有，或已被释放 */
+            if (job->file < 0) {
+                face->state = FONT_FAILED;
+                font_swap_finish(job);
+                return -1;
+            }
+            font_files[job->file].refs++;
+        }
+        face->info = job->parsed.info;
+        face->coverage = job->parsed.coverage;
+        face->em_scale = job->parsed.em_scale;
+        face->file = job->file;
+        face->state = FONT_READY;
+        job->parsed.coverage = NULL;
+        job->file = -1;
+        job->data = NULL;
+    }
+
+    /* 合并预热的字形 */
+    for (int i = 0; i < job->glyph_count; i++) {
+        GlyphEntry *entry = job->glyphs[i];
+        if (glyph_cache_find(entry->key, entry->size, entry->subpixel, entry->node.hash) ||
+            cache_insert(&glyph_cache, &entry->node) != 0) {
+            free(entry);
+        }
+    }
+    job->glyph_count = 0;
+
+    lcd_font_t *old = lcd_get_font();       /* 多持有一个引用，下一次调用时释放 */
+    lcd_set_font(face);
+    if (old == face) face_unref(old);
+    else font_swap.retired = old;
+    font_swap_finish(job);
+    return 1;
+}
+
+/* 创建离屏表面 */
+lcd_surface_t *lcd_surface_create(int width, int height, lcd_format_t format) {
+    if (width <= 0 || height <= 0) return NULL;
+
+    size_t bpp = (format == LCD_FORMAT_A8) ? 1 : 2;     /* 每像素字节数 */
+    lcd_surface_t *surface = (lcd_surface_t*)malloc(sizeof(lcd_surface_t));
+    if (!surface) {
+        perror("malloc");
+        return NULL;
+    }
+    surface->pixels = calloc((size_t)width * height, bpp);     /* 初始内容为全 0（黑色或全透明） */
+    if (!surface->pixels) {
+        perror("malloc");
+        free(surface);
+        return NULL;
+    }
+    surface->format = format;
+    surface->width = width;
+    surface->height = height;
+    surface->stride = width;
+    return surface;
+}
+
+/* 释放离屏表面，若它是当前绘制目标则恢复为屏幕 */
+void lcd_surface_destroy(lcd_surface_t *surface) {
+    if (surface && surface != &screen) {
+        if (target == surface) target = &screen;
+        free(surface->pixels);
+        free(surface);
+    }
+}
+
+/* 设置绘制目标，NULL 表示屏幕 */
+void lcd_set_target(lcd_surface_t *surface) {
+    target = surface ? surface : &screen;
+}
+
+/*
+* 裁剪复制区域
+* 把源矩形 (*sx, *sy, *w, *h) 先裁剪到源表面内，再把对应的目标矩形 (*dx, *dy) 裁剪到目标表面内
+* （目标为当前绘制目标时还要裁剪到当前裁剪矩形内），两次裁剪同步调整另一侧的坐标。区域为空时返回 0。
+*/
+static int clip_blit_rect(const lcd_surface_t *src, const lcd_surface_t *dst,
+                          int *sx, int *sy, int *w, int *h, int *dx, int *dy) {
+    if (*sx < 0) { *w += *sx; *dx -= *sx; *sx = 0; }
+    if (*sy < 0) { *h += *sy; *dy -= *sy; *sy = 0; }
+    if (*sx + *w > src->width) *w = src->width - *sx;
+    if (*sy + *h > src->height) *h = src->height - *sy;
+
+    /* 目标是当前绘制目标时同时受裁剪矩形约束 */
+    int x0 = 0, y0 = 0, x1 = dst->width, y1 = dst->height;
+    if (dst == target) {
+        const ClipRect *clip = &clip_stack[clip_top];
+        if (clip->x0 > x0) x0 = clip->x0;
+        if (clip->y0 > y0) y0 = clip->y0;
+        if (clip->x1 < x1) x1 = clip->x1;
+        if (clip->y1 < y1) y1 = clip->y1;
+    }
+    if (*dx < x0) { *w -= x0 - *dx; *sx += x0 - *dx; *dx = x0; }
+    if (*dy < y0) { *h -= y0 - *dy; *sy += y0 - *dy; *dy = y0; }
+    if (*dx + *w > x1) *w = x1 - *dx;
+    if (*dy + *h > y1) *h = y1 - *dy;
+
+    return *w > 0 && *h > 0;
+}
+
+/*
+* 同一表面内复制
+* 把 surface 中的矩形 (sx, sy, w, h) 复制到 (dx, dy) 处，区域已裁剪完毕。
+* 源与目标重叠时，目标在源下方则自下而上逐行复制，否则自上而下，保证每行在被覆盖前已被读取；
+* 行内的左右重叠由 memmove 处理。
+*/
+static void surface_copy_rows(lcd_surface_t *surface, int sx, int sy, int w, int h, int dx, int dy) {
+    size_t bpp = (surface->format == LCD_FORMAT_A8) ? 1 : 2;
+    size_t pitch = (size_t)surface->stride * bpp;
+    uint8_t *src = (uint8_t*)surface->pixels + sy * pitch + sx * bpp;
+    uint8_t *dst = (uint8_t*)surface->pixels + dy * pitch + dx * bpp;
+
+    if (dy > sy) {
+        for (int j = h - 1; j >= 0; j--) memmove(dst + j * pitch, src + j * pitch, w * bpp);
+    } else {
+        for (int j = 0; j < h; j++) memmove(dst + j * pitch, src + j * pitch, w * bpp);
+    }
+}
+
+/* 复制表面区域 */
+void lcd_blit(const lcd_surface_t *src, int sx, int sy, int w, int h, lcd_surface_t *dst, int dx, int dy) {
+    /*
+    * 功能：把 src 中的矩形 (sx, sy, w, h) 复制到 dst 的 (dx, dy) 处，src、dst 为 NULL 表示屏幕。
+    * 逻辑：两侧裁剪后，同格式表面逐行 memcpy；格式不同时逐像素转换
+    *      （RGB565 转为灰度写入 A8，A8 灰度展开为 RGB565）。src 与 dst 为同一表面时按重叠方向逐行 memmove。
+    */
+    if (!src) src = &screen;
+    if (!dst) dst = &screen;
+    if (!src->pixels || !dst->pixels) return;
+    if (!clip_blit_rect(src, dst, &sx, &sy, &w, &h, &dx, &dy)) return;
+
+    /* 同一表面内复制，源与目标可能重叠 */
+    if (src == dst) {
+        surface_copy_rows(dst, sx, sy, w, h, dx, dy);
+        return;
+    }
+
+    for (int j = 0; j < h; j++) {
+        if (src->format == LCD_FORMAT_A8 && dst->format == LCD_FORMAT_A8) {
+            memcpy(surface_row8(dst, dy + j) + dx, surface_row8(src, sy + j) + sx, w);
+        } else if (src->format == LCD_FORMAT_A8) {
+            const uint8_t *s = surface_row8(src, sy + j) + sx;
+            uint16_t *d = surface_row16(dst, dy + j) + dx;
+            for (int i = 0; i < w; i++) d[i] = RGB565(s[i], s[i], s[i]);
+        } else if (dst->format == LCD_FORMAT_A8) {
+            const uint16_t *s = surface_row16(src, sy + j) + sx;
+            uint8_t *d = surface_row8(dst, dy + j) + dx;
+            for (int i = 0; i < w; i++) d[i] = color_to_gray(s[i]);
+        } else {
+            memcpy(surface_row16(dst, dy + j) + dx, surface_row16(src, sy + j) + sx, w * sizeof(uint16_t));
+        }
+    }
+}
+
+/* 移动绘制目标中的区域 */
+void lcd_copy_area(int x, int y, int width, int height, int dst_x, int dst_y) {
+    /*
+    * 功能：把当前绘制目标中的矩形 (x, y, width, height) 复制到 (dst_x, dst_y) 处，源与目标可以重叠，
+    *      适用于滚动日志、终端等：滚动一次只需一次区域移动，再绘制新露出的一行。
+    * 逻辑：源矩形裁剪到绘制目标内，目标矩形裁剪到当前裁剪矩形内，再按重叠方向选择逐行复制的顺序。
+    *      复制后源区域中未被目标覆盖的部分保持原内容，由调用者重绘。
+    */
+    if (!target->pixels) return;
+    if (!clip_blit_rect(target, target, &x, &y, &width, &height, &dst_x, &dst_y)) return;
+    surface_copy_rows(target, x, y, width, height, dst_x, dst_y);
+}
+
+/* 以 A8 表面为覆盖度混合颜色 */
+void lcd_blit_alpha(const lcd_surface_t *src, int sx, int sy, int w, int h,
+                    lcd_surface_t *dst, int dx, int dy, color_t color) {
+    /*
+    * 功能：把 A8 表面 src 中的矩形 (sx, sy, w, h) 作为覆盖度，将 color 混合到 dst 的 (dx, dy) 处，
+    *      dst 为 NULL 表示屏幕。适合预先渲染好的文字、图标蒙版，可以每次换用不同颜色。
+    * 逻辑：两侧裁剪后逐行调用与文字渲染相同的覆盖度混合。
+    */
+    if (!src || src->format != LCD_FORMAT_A8 || !src->pixels) return;
+    if (!dst) dst = &screen;
+    if (!dst->pixels) return;
+    if (!clip_blit_rect(src, dst, &sx, &sy, &w, &h, &dx, &dy)) return;
+
+    /* 区域已按目标裁剪完毕，混合期间暂停裁剪栈，避免作用到非当前目标的表面 */
+    lcd_surface_t *saved = target;
+    int saved_clip = clip_suspend();
+    target = dst;
+    for (int j = 0; j < h; j++) {
+        blend_coverage(surface_row8(src, sy + j) + sx, w, 1, dx, dy + j, color, dx, dy + j, dx + w, dy + j + 1);
+    }
+    target = saved;
+    clip_resume(saved_clip);
+}
+
+/*
+* 页面缓存
+* 整页绘制到离屏表面后保存下来，再次切换到该页面时只需一次整屏复制。
+* 页面按最近最少使用淘汰，可选行程编码（RLE）压缩，压缩后比原始数据大时按原始数据保存。
+*/
+#define PAGE_CACHE_DEFAULT_PAGES    10                  /* 默认最多缓存的页面数 */
+#define PAGE_CACHE_DEFAULT_BUDGET   (4 * 1024 * 1024)   /* 默认字节预算 */
+
+/* 缓存的单个页面 */
+typedef struct {
+    int id;                 /* 页面编号 */
+    int compressed;         /* 1 表示 data 为 RLE 数据，0 表示原始像素 */
+    int width, height;      /* 保存时的屏幕尺寸 */
+    uint16_t *data;         /* 页面数据，为 NULL 表示该项空闲 */
+    size_t bytes;           /* data 占用的字节数 */
+    unsigned int last_used; /* 最近使用时刻 */
+} CachedPage;
+
+static CachedPage *pages = NULL;                        /* 页面数组，容量为 page_max */
+static int page_max = PAGE_CACHE_DEFAULT_PAGES;         /* 最多缓存的页面数 */
+static size_t page_budget = PAGE_CACHE_DEFAULT_BUDGET;  /* 页面缓存字节预算 */
+static size_t page_bytes = 0;                           /* 当前占用字节数 */
+static int page_compress = 1;                           /* 是否 RLE 压缩 */
+static unsigned int page_tick = 0;
+static lcd_surface_t *page_canvas = NULL;               /* 绘制页面用的离屏表面，可复用 */
+
+/* 释放一个页面 */
+static void page_release(CachedPage *page) {
+    if (page->data) {
+        page_bytes -= page->bytes;
+        free(page->data);
+        page->data = NULL;
+    }
+}
+
+/* 释放全部页面与离屏表面 */
+static void page_cache_clear(void) {
+    if (pages) {
+        for (int k = 0; k < page_max; k++) page_release(&pages[k]);
+        free(pages);
+        pages = NULL;
+    }
+    lcd_surface_destroy(page_canvas);
+    page_canvas = NULL;
+}
+
+/* 设置页面缓存参数，已缓存的页面全部释放 */
+void lcd_page_cache_config(int max_pages, size_t budget, int compress) {
+    page_cache_clear();
+    page_max = max_pages > 0 ? max_pages : 0;
+    page_budget = budget;
+    page_compress = compress;
+}
+
+/* 使页面缓存失效，page_id 为 -1 时使全部页面失效 */
+void lcd_page_invalidate(int page_id) {
+    if (!pages) return;
+    for (int k = 0; k < page_max; k++) {
+        if (pages[k].data && (page_id == -1 || pages[k].id == page_id)) {
+            page_release(&pages[k]);
+        }
+    }
+}
+
+/*
+* RLE 编码
+* 格式为若干个（重复次数，颜色）的 16 位对，重复次数 1~65535。out 为 NULL 时只计算编码后的
+* 16 位字数，用于先确定大小再分配内存。
+*/
+static size_t page_rle_encode(const uint16_t *src, size_t count, uint16_t *out) {
+    size_t words = 0;
+    size_t i = 0;
+    while (i < count) {
+        uint16_t color = src[i];
+        size_t run = 1;
+        while (i + run < count && run < 65535 && src[i + run] == color) run++;
+        if (out) {
+            out[words] = (uint16_t)run;
+            out[words + 1] = color;
+        }
+        words += 2;
+        i += run;
+    }
+    return words;
+}
+
+/* 把缓存的页面恢复到屏幕 */
+static void page_restore(const CachedPage *page) {
+    size_t count = (size_t)page->width * page->height;
+    if (!page->compressed) {
+        memcpy(screen.pixels, page->data, count * sizeof(uint16_t));   /* 整屏一次复制 */
+        return;
+    }
+
+    /* 逐个行程直接展开到帧缓冲，不需要中间缓冲区 */
+    uint16_t *dst = (uint16_t*)screen.pixels;
+    const uint16_t *run = page->data;
+    size_t done = 0;
+    while (done < count) {
+        size_t n = run[0];
+        uint16_t color = run[1];
+        for (size_t i = 0; i < n; i++) dst[done + i] = color;
+        done += n;
+        run += 2;
+    }
+}
+
+/*
+* 保存页面
+* 逻辑：压缩开启时先计算 RLE 大小，小于原始数据则按 RLE 保存，否则保存原始像素。
+*      按最近最少使用淘汰旧页面，直到页面数和字节数都满足限制；单个页面超过预算时不缓存。
+*/
+static void page_store(int page_id, const lcd_surface_t *canvas) {
+    size_t count = (size_t)canvas->width * canvas->height;
+    size_t raw_bytes = count * sizeof(uint16_t);
+    size_t rle_bytes = page_compress ? page_rle_encode((const uint16_t*)canvas->pixels, count, NULL) * sizeof(uint16_t) : raw_bytes;
+    int compressed = rle_bytes < raw_bytes;
+    size_t bytes = compressed ? rle_bytes : raw_bytes;
+    if (page_max == 0 || bytes > page_budget) return;
+
+    if (!pages) {
+        pages = (CachedPage*)calloc(page_max, sizeof(CachedPage));
+        if (!pages) return;
+    }
+
+    /* 找到空闲项，必要时淘汰最久未用的页面 */
+    CachedPage *slot = NULL;
+    while (1) {
+        CachedPage *oldest = NULL;
+        slot = NULL;
+        for (int k = 0; k < page_max; k++) {
+            if (!pages[k].data) {
+                if (!slot) slot = &pages[k];
+            } else if (!oldest || pages[k].last_used < oldest->last_used) {
+                oldest = &pages[k];
+            }
+        }
+        if (slot && page_bytes + bytes <= page_budget) break;
+        if (!oldest) return;
+        page_release(oldest);
+    }
+
+    uint16_t *data = (uint16_t*)malloc(bytes);
+    if (!data) return;
+    if (compressed) {
+        page_rle_encode((const uint16_t*)canvas->pixels, count, data);
+    } else {
+        memcpy(data, canvas->pixels, raw_bytes);
+    }
+    slot->id = page_id;
+    slot->compressed = compressed;
+    slot->width = canvas->width;
+    slot->height = canvas->height;
+    slot->data = data;
+    slot->bytes = bytes;
+    slot->last_used = ++page_tick;
+    page_bytes += bytes;
+}
+
+/* 显示页面 */
+void lcd_page_show(int page_id, void (*draw)(void *user), void *user) {
+    /*
+    * 功能：显示编号为 page_id 的页面。页面已缓存时直接恢复到屏幕；否则调用 draw(user)
+    *      把页面绘制到离屏表面（draw 中照常调用各绘制函数），再整屏复制到屏幕并缓存。
+    * 逻辑：无论是否命中，屏幕都只经历一次整屏写入，不会出现逐个控件重绘的过程。
+    */
+    if (!lcd || !screen.pixels) return;
+
+    if (pages) {
+        for (int k = 0; k < page_max; k++) {
+            CachedPage *page = &pages[k];
+            if (page->data && page->id == page_id &&
+                page->width == screen.width && page->height == screen.height) {
+                page->last_used = ++page_tick;
+                page_restore(page);
+                return;
+            }
+        }
+    }
+    if (!draw) return;
+
+    /* 未命中：绘制到离屏表面 */
+    if (!page_canvas) {
+        page_canvas = lcd_surface_create(screen.width, screen.height, LCD_FORMAT_RGB565);
+        if (!page_canvas) return;
+    }
+    lcd_surface_t *saved = target;
+    int saved_clip = clip_suspend();    /* 页面绘制不受调用者裁剪矩形的影响 */
+    target = page_canvas;
+    draw(user);
+    target = saved;
+    clip_resume(saved_clip);
+
+    lcd_blit(page_canvas, 0, 0, page_canvas->width, page_canvas->height, NULL, 0, 0);
+    lcd_page_invalidate(page_id);   /* 同一编号只保留最新内容 */
+    page_store(page_id, page_canvas);
+}
+
+/*
+* 实时曲线（滚动波形图）
+* 曲线区域每列对应一个采样，环形缓冲区保存最近 width 个采样。新采样到来时，
+* 先把区域内已有的像素整体左移一列，再只绘制最右侧的新列，每个采样的开销与区域高度成正比。
+*/
+struct lcd_chart {
+    int x, y;               /* 曲线区域左上角坐标 */
+    int width, height;      /* 曲线区域尺寸，width 同时是环形缓冲区容量 */
+    float min, max;         /* 纵轴量程，超出量程的采样按边界绘制 */
+    color_t line_color;     /* 曲线颜色 */
+    color_t bg_color;       /* 背景颜色 */
+    float *samples;         /* 环形缓冲区 */
+    int head;               /* 下一个采样写入的位置 */
+    int count;              /* 已保存的采样数量 */
+    int valid;              /* 为 0 时表示屏幕内容不可信，下一次追加采样时整体重绘 */
+};
+
+/* 创建实时曲线 */
+lcd_chart_t *lcd_chart_create(int x, int y, int width, int height, float min, float max,
+                              color_t line_color, color_t bg_color) {
+    if (width <= 0 || height <= 0 || !(max > min)) return NULL;
+
+    lcd_chart_t *chart = (lcd_chart_t*)calloc(1, sizeof(lcd_chart_t));
+    if (!chart) {
+        perror("malloc");
+        return NULL;
+    }
+    chart->samples = (float*)malloc(width * sizeof(float));
+    if (!chart->samples) {
+        perror("malloc");
+        free(chart);
+        return NULL;
+    }
+    chart->x = x;
+    chart->y = y;
+    chart->width = width;
+    chart->height = height;
+    chart->min = min;
+    chart->max = max;
+    chart->line_color = line_color;
+    chart->bg_color = bg_color;
+    return chart;
+}
+
+/* 销毁实时曲线，不改变屏幕内容 */
+void lcd_chart_destroy(lcd_chart_t *chart) {
+    if (chart) {
+        free(chart->samples);
+        free(chart);
+    }
+}
+
+/* 曲线区域被其他绘制覆盖后调用，下一次追加采样时整体重绘 */
+void lcd_chart_invalidate(lcd_chart_t *chart) {
+    if (chart) chart->valid = 0;
+}
+
+/* 采样值换算为屏幕行坐标，超出量程时取边界 */
+static int chart_row(const lcd_chart_t *chart, float value) {
+    float t = (value - chart->min) / (chart->max - chart->min);
+    if (t < 0) t = 0;
+    if (t > 1) t = 1;
+    return chart->y + chart->height - 1 - (int)(t * (chart->height - 1) + 0.5f);
+}
+
+/*
+* 绘制一列
+* 用背景色清除第 col 列，再用竖线连接上一个采样与本采样的行坐标，使相邻列的曲线保持连续。
+* prev 为 NULL 表示没有上一个采样，只绘制一个点。
+*/
+static void chart_draw_column(const lcd_chart_t *chart, int col, const float *prev, float value) {
+    int x = chart->x + col;
+    int row = chart_row(chart, value);
+    draw_vline(x, chart->y, chart->y + chart->height - 1, chart->bg_color);
+    draw_vline(x, prev ? chart_row(chart, *prev) : row, row, chart->line_color);
+}
+
+/* 整体重绘曲线区域：清除背景后按时间顺序绘制缓冲区中的全部采样，最新的采样位于最右列 */
+static void chart_redraw(lcd_chart_t *chart) {
+    fill_rect(chart->x, chart->y, chart->x + chart->width, chart->y + chart->height, chart->bg_color);
+    int first = chart->head - chart->count;
+    if (first < 0) first += chart->width;
+    const float *prev = NULL;
+    for (int k = 0; k < chart->count; k++) {
+        const float *value = &chart->samples[(first + k) % chart->width];
+        chart_draw_column(chart, chart->width - chart->count + k, prev, *value);
+        prev = value;
+    }
+}
+
+/* 追加采样 */
+void lcd_chart_push(lcd_chart_t *chart, float value) {
+    /*
+    * 功能：向曲线追加一个采样并刷新显示。
+    * 逻辑：采样写入环形缓冲区。屏幕内容可信且曲线区域完整位于可绘制范围内时，用 lcd_copy_area 把区域左移一列，
+    *      只绘制最右一列；否则（首次绘制、被覆盖或被裁剪）整体重绘。
+    */
+    if (!chart || !lcd) return;
+
+    int last = chart->head - 1 < 0 ? chart->width - 1 : chart->head - 1;
+    float prev = chart->samples[last];
+    int has_prev = chart->count > 0;
+
+    chart->samples[chart->head] = value;
+    chart->head = (chart->head + 1) % chart->width;
+    if (chart->count < chart->width) chart->count++;
+
+    /* 区域被裁剪时，移入的像素可能来自不可见部分，只能整体重绘 */
+    int x0 = chart->x, y0 = chart->y;
+    int x1 = chart->x + chart->width, y1 = chart->y + chart->height;
+    int whole = clip_to_target(&x0, &y0, &x1, &y1) &&
+                x0 == chart->x && y0 == chart->y &&
+                x1 == chart->x + chart->width && y1 == chart->y + chart->height;
+
+    if (!chart->valid || !whole) {
+        chart_redraw(chart);
+        chart->valid = whole;
+        return;
+    }
+    lcd_copy_area(chart->x + 1, chart->y, chart->width - 1, chart->height, chart->x, chart->y);
+    chart_draw_column(chart, chart->width - 1, has_prev ? &prev : NULL, value);
+}
+
+/*
+* 文本终端
+* 固定行列的字符网格，单元宽度取可打印 ASCII 字符前进宽度的最大值，CJK 等宽字符占两个单元。
+* 每个单元保存码点、前景色、背景色和脏标记；屏幕行以环形缓冲区组织，滚动只移动起始行下标，
+* 屏幕上用一次 lcd_copy_area 上移像素。追加文本后只重绘被改动的单元。
+*/
+#define CONSOLE_TAB_WIDTH   8       /* 制表符对齐的列数 */
+#define CONSOLE_PRINTF_BUF  256     /* lcd_console_printf 栈上格式化缓冲区大小 */
+
+/* 终端中的单个字符单元 */
+typedef struct {
+    int codepoint;          /* 字符码点，空白单元为空格 */
+    color_t fg;             /* 前景色 */
+    color_t bg;             /* 背景色 */
+    unsigned char wide;     /* 0：普通单元；1：宽字符的左半；2：宽字符的右半 */
+    unsigned char dirty;    /* 为 1 时表示需要重绘 */
+} ConsoleCell;
+
+struct lcd_console {
+    int x, y;               /* 终端左上角坐标 */
+    int cols, rows;         /* 列数与行数 */
+    int font_size;          /* 字体大小 */
+    float scale;            /* 字体缩放比例 */
+    int cell_width;         /* 单元宽度 */
+    int cell_height;        /* 单元高度（行高） */
+    int baseline;           /* 基线相对单元上边界的偏移 */
+    color_t fg, bg;         /* 当前前景色与背景色，作用于之后追加的文本 */
+    ConsoleCell *cells;     /* rows * cols 个单元，按环形缓冲区的行顺序存放 */
+    int top;                /* 屏幕第一行对应的缓冲区行 */
+    int cur_col, cur_row;   /* 光标所在的列与屏幕行 */
+    int scrolled;           /* 上次刷新之后累计滚动的行数 */
+    int valid;              /* 为 0 时表示屏幕内容不可信，下一次刷新整体重绘 */
+};
+
+/* 判断字符是否按两个单元显示（CJK、谚文、全角符号等东亚宽字符） */
+static int console_is_wide(int codepoint) {
+    return (codepoint >= 0x1100 && codepoint <= 0x115F) ||
+           (codepoint >= 0x2E80 && codepoint <= 0xA4CF && codepoint != 0x303F) ||
+           (codepoint >= 0xAC00 && codepoint <= 0xD7A3) ||
+           (codepoint >= 0xF900 && codepoint <= 0xFAFF) ||
+           (codepoint >= 0xFE30 && codepoint <= 0xFE4F) ||
+           (codepoint >= 0xFF00 && codepoint <= 0xFF60) ||
+           (codepoint >= 0xFFE0 && codepoint <= 0xFFE6) ||
+           (codepoint >= 0x20000 && codepoint <= 0x3FFFD);
+}
+
+/* 返回屏幕第 row 行的首个单元 */
+static ConsoleCell *console_line(const lcd_console_t *con, int row) {
+    return con->cells + (size_t)((con->top + row) % con->rows) * con->cols;
+}
+
+/* 把单元清为当前颜色的空格并标记为脏 */
+static void console_blank(const lcd_console_t *con, ConsoleCell *cell) {
+    cell->codepoint = ' ';
+    cell->fg = con->fg;
+    cell->bg = con->bg;
+    cell->wide = 0;
+    cell->dirty = 1;
+}
+
+/* 创建文本终端 */
+lcd_console_t *lcd_console_create(int x, int y, int cols, int rows, int font_size,
+                                  color_t fg, color_t bg) {
+    if (!lcd || cols <= 0 || rows <= 0) return NULL;
+
+    lcd_console_t *con = (lcd_console_t*)calloc(1, sizeof(lcd_console_t));
+    if (!con) {
+        perror("malloc");
+        return NULL;
+    }
+    con->cells = (ConsoleCell*)malloc((size_t)cols * rows * sizeof(ConsoleCell));
+    if (!con->cells) {
+        perror("malloc");
+        free(con);
+        return NULL;
+    }
+
+    /* 单元尺寸由字体度量决定：宽度取可打印 ASCII 字符前进宽度的最大值 */
+    int ascent, descent, max_advance = 0;
+    stbtt_GetFontVMetrics(font, &ascent, &descent, 0);
+    for (int c = 0x20; c < 0x7F; c++) {
+        int advance, lsb;
+        stbtt_GetCodepointHMetrics(font, c, &advance, &lsb);
+        if (advance > max_advance) max_advance = advance;
+    }
+    con->scale = stbtt_ScaleForPixelHeight(font, font_size);
+    con->cell_width = (int)ceil(max_advance * con->scale);
+    con->cell_height = (int)((ascent - descent) * con->scale);
+    con->baseline = (int)(ascent * con->scale);
+    if (con->cell_width <= 0) con->cell_width = 1;
+    if (con->cell_height <= 0) con->cell_height = 1;
+
+    con->x = x;
+    con->y = y;
+    con->cols = cols;
+    con->rows = rows;
+    con->font_size = font_size;
+    con->fg = fg;
+    con->bg = bg;
+    for (int k = 0; k < cols * rows; k++) console_blank(con, &con->cells[k]);
+    return con;
+}
+
+/* 销毁文本终端，不改变屏幕内容 */
+void lcd_console_destroy(lcd_console_t *con) {
+    if (con) {
+        free(con->cells);
+        free(con);
+    }
+}
+
+/* 终端区域被其他绘制覆盖后调用，下一次刷新时整体重绘 */
+void lcd_console_invalidate(lcd_console_t *con) {
+    if (con) con->valid = 0;
+}
+
+/* 设置之后追加文本的前景色与背景色 */
+void lcd_console_set_color(lcd_console_t *con, color_t fg, color_t bg) {
+    if (con) {
+        con->fg = fg;
+        con->bg = bg;
+    }
+}
+
+/* 光标换到下一行，已在最后一行时滚动一行：起始行下移，新露出的行清空 */
+static void console_newline(lcd_console_t *con) {
+    con->cur_col = 0;
+    if (con->cur_row < con->rows - 1) {
+        con->cur_row++;
+        return;
+    }
+    con->top = (con->top + 1) % con->rows;
+    con->scrolled++;
+    ConsoleCell *line = console_line(con, con->rows - 1);
+    for (int c = 0; c < con->cols; c++) console_blank(con, &line[c]);
+}
+
+/*
+* 写入一个字符
+* 逻辑：处理 \n、\r、\t 与退格；宽字符在行尾放不下时先换行。覆盖宽字符的一半时，
+*      另一半同时清为空格，避免残留半个字形。写入的单元标记为脏。
+*/
+static void console_put(lcd_console_t *con, int codepoint) {
+    if (codepoint == '\n') {
+        console_newline(con);
+        return;
+    }
+    if (codepoint == '\r') {
+        con->cur_col = 0;
+        return;
+    }
+    if (codepoint == '\b') {
+        if (con->cur_col > 0) con->cur_col--;
+        return;
+    }
+    if (codepoint == '\t') {
+        int next = (con->cur_col / CONSOLE_TAB_WIDTH + 1) * CONSOLE_TAB_WIDTH;
+        while (con->cur_col < next && con->cur_col < con->cols) console_put(con, ' ');
+        return;
+    }
+    if (codepoint < 32) return;     /* 跳过其他控制字符 */
+
+    int span = console_is_wide(codepoint) ? 2 : 1;
+    if (span > con->cols) return;   /* 只有一列的终端无法显示宽字符 */
+    if (con->cur_col + span > con->cols) console_newline(con);
+
+    ConsoleCell *line = console_line(con, con->cur_row);
+    int col = con->cur_col;
+    for (int k = col; k < col + span; k++) {
+        if (line[k].wide == 1 && k + 1 < con->cols) console_blank(con, &line[k + 1]);
+        if (line[k].wide == 2 && k > 0) console_blank(con, &line[k - 1]);
+    }
+    for (int k = col; k < col + span; k++) {
+        line[k].codepoint = codepoint;
+        line[k].fg = con->fg;
+        line[k].bg = con->bg;
+        line[k].wide = (span == 1) ? 0 : (k == col ? 1 : 2);
+        line[k].dirty = 1;
+    }
+    con->cur_col += span;
+}
+
+/* 重绘第 row 行从 col 开始、占 span 个单元的字符 */
+static void console_paint(const lcd_console_t *con, int row, int col, int span, const ConsoleCell *cell) {
+    int x0 = con->x + col * con->cell_width;
+    int y0 = con->y + row * con->cell_height;
+    int x1 = x0 + span * con->cell_width;
+    int y1 = y0 + con->cell_height;
+
+    fill_rect(x0, y0, x1, y1, cell->bg);
+    if (cell->codepoint == ' ') return;
+
+    /* 字形在单元内水平居中，超出单元的部分被裁剪 */
+    int key = font_key(cell->codepoint);
+    float xpos = x0 + (span * con->cell_width - key_advance(key) * con->scale) / 2;
+    render_glyph(key, xpos, y0 + con->baseline, con->font_size, cell->fg, x0, y0, x1, y1);
+}
+
+/*
+* 刷新终端
+* 逻辑：若上次刷新后发生过滚动，用一次 lcd_copy_area 把仍然可见的行上移；脏标记随行保存在环形缓冲区中，
+*      移动后依然对应正确的屏幕位置。随后只重绘脏单元。屏幕内容不可信、滚动超过一屏或终端区域被裁剪时
+*      （移入的像素可能来自不可见部分）整体重绘。
+*/
+static void console_flush(lcd_console_t *con) {
+    int width = con->cols * con->cell_width;
+    int height = con->rows * con->cell_height;
+    int x0 = con->x, y0 = con->y, x1 = con->x + width, y1 = con->y + height;
+    int whole = clip_to_target(&x0, &y0, &x1, &y1) &&
+                x0 == con->x && y0 == con->y && x1 == con->x + width && y1 == con->y + height;
+
+    if (!con->valid || !whole || con->scrolled >= con->rows) {
+        for (int k = 0; k < con->cols * con->rows; k++) con->cells[k].dirty = 1;
+    } else if (con->scrolled > 0) {
+        int shift = con->scrolled * con->cell_height;
+        lcd_copy_area(con->x, con->y + shift, width, height - shift, con->x, con->y);
+    }
+    con->scrolled = 0;
+    con->valid = whole;
+
+    for (int r = 0; r < con->rows; r++) {
+        ConsoleCell *line = console_line(con, r);
+        for (int c = 0; c < con->cols; c++) {
+            ConsoleCell *cell = &line[c];
+            if (cell->wide == 1 && c + 1 < con->cols) {
+                /* 宽字符任一半为脏时整体重绘 */
+                if (cell->dirty || line[c + 1].dirty) console_paint(con, r, c, 2, cell);
+                cell->dirty = line[c + 1].dirty = 0;
+                c++;
+            } else if (cell->dirty) {
+                console_paint(con, r, c, 1, cell);
+                cell->dirty = 0;
+            }
+        }
+    }
+}
+
+/* 追加文本 */
+void lcd_console_write(lcd_console_t *con, const char *text) {
+    if (!con || !text || !lcd) return;
+    lcd_console_write_n(con, text, strlen(text));
+}
+
+/* 追加长度为 len 字节的文本 */
+void lcd_console_write_n(lcd_console_t *con, const char *text, int len) {
+    if (!con || !text || !lcd || len < 0) return;
+
+    Utf8Reader reader;
+    int codepoint;
+    utf8_reader_init(&reader, text, len);
+    while (utf8_next(&reader, &codepoint) >= 0) {
+        console_put(con, codepoint);
+    }
+    console_flush(con);
+}
+
+/* 按格式追加文本 */
+int lcd_console_printf(lcd_console_t *con, const char *format, ...) {
+    /*
+    * 功能：与 printf 相同的格式化规则，结果追加到终端，返回格式化后的字节数。
+    * 逻辑：先格式化到栈上的缓冲区，结果更长时才按实际长度分配一次。
+    */
+    if (!con || !format) return -1;
+
+    char buf[CONSOLE_PRINTF_BUF];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (n < 0) return n;
+
+    if (n < (int)sizeof(buf)) {
+        lcd_console_write_n(con, buf, n);
+        return n;
+    }
+
+    char *text = (char*)malloc(n + 1);
+    if (!text) {
+        perror("malloc");
+        return -1;
+    }
+    va_start(args, format);
+    vsnprintf(text, n + 1, format, args);
+    va_end(args);
+    lcd_console_write_n(con, text, n);
+    free(text);
+    return n;
+}
+
+/* 清空终端，光标回到左上角 */
+void lcd_console_clear(lcd_console_t *con) {
+    if (!con || !lcd) return;
+    for (int k = 0; k < con->cols * con->rows; k++) console_blank(con, &con->cells[k]);
+    con->cur_col = con->cur_row = 0;
+    con->scrolled = 0;
+    console_flush(con);
+}
+
+/*
+* 段落排版
+* 一次遍历求出每个字符的累计笔位，换行时直接用笔位相减得到行宽，不需要反复测量前缀。
+* 断行规则：CJK 等宽字符前后均可断行，拉丁文本在空格后断行（行尾空格悬挂，不计入行宽），
+* 遵守基本的避头尾规则（句读、右括号等不出现在行首，左括号等不出现在行尾），\n 强制换行。
+* 单词长于一行时在字符处强制断开。
+*/
+
+/* 排版中的单个字符 */
+typedef struct {
+    int codepoint;      /* 字符码点 */
+    int offset;         /* 字符在文本中的字节偏移 */
+    float x;            /* 字符笔位，相对段落起点（含前面所有字符的前进宽度与字距调整） */
+    float advance;      /* 字符前进宽度 */
+} LayoutChar;
+
+/* 排版结果中的一行 */
+typedef struct {
+    int first;          /* 行首字符下标 */
+    int end;            /* 下一行行首字符下标（本行包含行尾空格与换行符） */
+    float width;        /* 行宽，不含行尾空格与换行符 */
+} LayoutLine;
+
+struct lcd_layout {
+    char *text;             /* 文本副本 */
+    int len;                /* 文本字节数 */
+    int font_size;          /* 字体大小 */
+    float scale;            /* 字体缩放比例 */
+    int max_width;          /* 最大行宽 */
+    int line_height;        /* 行距（文本高度加行间距） */
+    int baseline;           /* 基线相对行上边界的偏移 */
+    LayoutChar *chars;      /* char_count + 1 个字符，最后一项的 x 与 offset 为段落末尾 */
+    int char_count;         /* 字符数量 */
+    LayoutLine *lines;      /* 各行 */
+    int line_count;         /* 行数，至少为 1 */
+    int line_capacity;      /* lines 数组容量 */
+};
+
+/* 不能出现在行首的字符（避头） */
+static const int layout_no_start[] = {
+    0x3002, 0xFF0C, 0x3001, 0xFF0E, 0xFF1A, 0xFF1B, 0xFF01, 0xFF1F,     /* 。，、．：；！？ */
+    0xFF09, 0x300D, 0x300F, 0x3011, 0x3015, 0x3009, 0x300B, 0x3017,     /* ）」』】〕〉》〗 */
+    0x201D, 0x2019, 0x30FB, 0x30FC, 0xFF5E, 0x3005, 0x2026, 0xFF05,     /* ”’・ー～々…％ */
+    0x3041, 0x3043, 0x3045, 0x3047, 0x3049, 0x3063, 0x3083, 0x3085, 0x3087,     /* 小写平假名 */
+    0x30A1, 0x30A3, 0x30A5, 0x30A7, 0x30A9, 0x30C3, 0x30E3, 0x30E5, 0x30E7,     /* 小写片假名 */
+    ')', ']', '}', ',', '.', '!', '?', ':', ';', '%'
+};
+
+/* 不能出现在行尾的字符（避尾） */
+static const int layout_no_end[] = {
+    0xFF08, 0x300C, 0x300E, 0x3010, 0x3014, 0x3008, 0x300A, 0x3016,     /* （「『【〔〈《〖 */
+    0x201C, 0x2018, 0xFF04, 0xFFE5,                                     /* “‘＄￥ */
+    '(', '[', '{'
+};
+
+/* 判断码点是否在表中 */
+static int codepoint_in(int codepoint, const int *table, int count) {
+    for (int k = 0; k < count; k++) {
+        if (table[k] == codepoint) return 1;
+    }
+    return 0;
+}
+
+#define LAYOUT_COUNT(table) ((int)(sizeof(table) / sizeof((table)[0])))
+
+/* 判断 prev 与 cur 之间是否允许断行 */
+static int layout_can_break(int prev, int cur) {
+    if (codepoint_in(cur, layout_no_start, LAYOUT_COUNT(layout_no_start))) return 0;
+    if (codepoint_in(prev, layout_no_end, LAYOUT_COUNT(layout_no_end))) return 0;
+    if (prev == ' ') return cur != ' ';
+    return console_is_wide(prev) || console_is_wide(cur);
+}
+
+/* 追加一行，行宽去掉行尾空格与换行符 */
+static int layout_add_line(lcd_layout_t *layout, int first, int end) {
+    if (layout->line_count == layout->line_capacity) {
+        int capacity = layout->line_capacity ? layout->line_capacity * 2 : 16;
+        LayoutLine *lines = (LayoutLine*)realloc(layout->lines, capacity * sizeof(LayoutLine));
+        if (!lines) {
+            perror("malloc");
+            return -1;
+        }
+        layout->lines = lines;
+        layout->line_capacity = capacity;
+    }
+
+    int last = end;
+    while (last > first && (layout->chars[last - 1].codepoint == ' ' || layout->chars[last - 1].codepoint == '\n')) {
+        last--;
+    }
+    LayoutLine *line = &layout->lines[layout->line_count++];
+    line->first = first;
+    line->end = end;
+    line->width = (last > first) ?
+                  layout->chars[last - 1].x + layout->chars[last - 1].advance - layout->chars[first].x : 0;
+    return 0;
+}
+
+/*
+* 断行
+* 逻辑：逐字符推进，记录本行最近一个断行机会。非空格字符的右边界超出最大行宽时，
+*      在最近的断行机会处断开；没有断行机会时在当前字符前强制断开（当前字符避头时连同前一个字符移到下一行）。
+*      断开后从新行行首重新扫描，重新扫描的只是被移到下一行的那部分字符。
+*/
+static int layout_break_lines(lcd_layout_t *layout) {
+    const LayoutChar *chars = layout->chars;
+    int first = 0;      /* 当前行行首字符 */
+    int brk = -1;       /* 最近的断行机会：下一行可以从该字符开始 */
+
+    for (int k = 0; k < layout->char_count; k++) {
+        int codepoint = chars[k].codepoint;
+        if (codepoint == '\n') {
+            if (layout_add_line(layout, first, k + 1)) return -1;
+            first = k + 1;
+            brk = -1;
+            continue;
+        }
+        if (k > first && layout_can_break(chars[k - 1].codepoint, codepoint)) brk = k;
+        if (codepoint == ' ') continue;     /* 行尾空格悬挂 */
+
+        if (chars[k].x + chars[k].advance - chars[first].x > layout->max_width && k > first) {
+            int cut = brk > first ? brk : k;
+            if (cut == k && k - 1 > first &&
+                codepoint_in(codepoint, layout_no_start, LAYOUT_COUNT(layout_no_start))) {
+                cut = k - 1;
+            }
+            if (layout_add_line(layout, first, cut)) return -1;
+            first = cut;
+            brk = -1;
+            k = cut - 1;    /* 从新行行首重新扫描 */
+        }
+    }
+    return layout_add_line(layout, first, layout->char_count);
+}
+
+/* 销毁排版结果 */
+void lcd_layout_destroy(lcd_layout_t *layout) {
+    if (layout) {
+        free(layout->text);
+        free(layout->chars);
+        free(layout->lines);
+        free(layout);
+    }
+}
+
+/*
+* 排版长度为 len 字节的文本
+* 逻辑：先一次遍历求出每个字符的笔位（与 lcd_render_text 相同的前进宽度与字距调整），再断行。
+*      text 不要求以 '\0' 结尾。
+*/
+static lcd_layout_t *layout_build(const char *text, int len, int font_size, int max_width, int line_spacing) {
+    lcd_layout_t *layout = (lcd_layout_t*)calloc(1, sizeof(lcd_layout_t));
+    if (!layout) {
+        perror("malloc");
+        return NULL;
+    }
+    layout->len = len;
+    layout->text = (char*)malloc(len + 1);
+    layout->chars = (LayoutChar*)malloc((len + 1) * sizeof(LayoutChar));   /* 字符数不超过字节数 */
+    if (!layout->text || !layout->chars) {
+        perror("malloc");
+        lcd_layout_destroy(layout);
+        return NULL;
+    }
+    memcpy(layout->text, text, len);
+    layout->text[len] = '\0';
+
+    int ascent, descent;
+    stbtt_GetFontVMetrics(font, &ascent, &descent, 0);
+    layout->font_size = font_size;
+    layout->scale = stbtt_ScaleForPixelHeight(font, font_size);
+    layout->max_width = max_width;
+    layout->baseline = (int)(ascent * layout->scale);
+    layout->line_height = (int)((ascent - descent) * layout->scale) + line_spacing;
+    if (layout->line_height < 1) layout->line_height = 1;
+
+    /* 累计笔位 */
+    float xpos = 0;
+    int n = 0;
+    Utf8Reader reader;
+    int codepoint, next_codepoint = 0;
+    utf8_reader_init(&reader, text, len);
+    int offset = utf8_next(&reader, &codepoint);
+    while (offset >= 0) {
+        int next_offset = utf8_next(&reader, &next_codepoint);
+        if (codepoint == '\t') codepoint = ' ';   /* 制表符按空格处理 */
+
+        LayoutChar *c = &layout->chars[n++];
+        c->codepoint = codepoint;
+        c->offset = offset;
+        c->x = xpos;
+        c->advance = 0;
+        if (codepoint >= 32) {  /* 控制字符不占宽度 */
+            int key = font_key(codepoint);
+            c->advance = key_advance(key) * layout->scale;
+            xpos += c->advance;
+            if (next_offset >= 0 && next_codepoint >= 32) {
+                xpos += layout->scale * key_kern(key, font_key(next_codepoint));
+            }
+        }
+        codepoint = next_codepoint;
+        offset = next_offset;
+    }
+    layout->chars[n].codepoint = 0;
+    layout->chars[n].offset = layout->len;
+    layout->chars[n].x = xpos;
+    layout->chars[n].advance = 0;
+    layout->char_count = n;
+
+    if (layout_break_lines(layout)) {
+        lcd_layout_destroy(layout);
+        return NULL;
+    }
+    return layout;
+}
+
+/* 创建段落排版 */
+lcd_layout_t *lcd_layout_create(const char *text, int font_size, int max_width, int line_spacing) {
+    /*
+    * 功能：按最大行宽 max_width 对 UTF-8 文本 text 分行，行距为文本高度加 line_spacing。
+    *      排版结果可反复绘制，文本在内部保存副本。失败返回 NULL。
+    */
+    if (!text || !lcd || max_width <= 0) return NULL;
+    return layout_build(text, strlen(text), font_size, max_width, line_spacing);
+}
+
+/* 对长度为 len 字节的文本排版 */
+lcd_layout_t *lcd_layout_create_n(const char *text, int len, int font_size, int max_width, int line_spacing) {
+    if (!text || !lcd || len < 0 || max_width <= 0) return NULL;
+    return layout_build(text, len, font_size, max_width, line_spacing);
+}
+
+/* 返回排版结果的行数 */
+int lcd_layout_line_count(const lcd_layout_t *layout) {
+    return layout ? layout->line_count : 0;
+}
+
+/* 返回排版结果的总高度 */
+int lcd_layout_height(const lcd_layout_t *layout) {
+    return layout ? layout->line_count * layout->line_height : 0;
+}
+
+/* 查询第 index 行：行首字节偏移、字节数（不含行尾换行符）与行宽，index 越界返回 -1 */
+int lcd_layout_get_line(const lcd_layout_t *layout, int index, int *start, int *len, int *width) {
+    if (!layout || index < 0 || index >= layout->line_count) return -1;
+
+    const LayoutLine *line = &layout->lines[index];
+    int end = line->end;
+    if (end > line->first && layout->chars[end - 1].codepoint == '\n') end--;
+    if (start) *start = layout->chars[line->first].offset;
+    if (len) *len = layout->chars[end].offset - layout->chars[line->first].offset;
+    if (width) *width = (int)ceil(line->width);
+    return 0;
+}
+
+/* 以 (x, top) 为行左上角绘制第 index 行，字形裁剪到 [x0, x1) x [y0, y1) 内 */
+static void layout_draw_line(const lcd_layout_t *layout, int index, int x, int top, color_t color,
+                             int x0, int y0, int x1, int y1) {
+    const LayoutLine *line = &layout->lines[index];
+    float origin = layout->chars[line->first].x;
+    for (int k = line->first; k < line->end; k++) {
+        const LayoutChar *c = &layout->chars[k];
+        if (c->codepoint <= ' ') continue;
+        render_glyph(font_key(c->codepoint), x + c->x - origin, top + layout->baseline, layout->font_size,
+                     color, x0, y0, x1, y1);
+    }
+}
+
+/* 返回字节偏移 offset 所在的行（行首字节偏移不大于 offset 的最后一行），二分查找 */
+static int layout_line_of(const lcd_layout_t *layout, int offset) {
+    int lo = 0, hi = layout->line_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (layout->chars[layout->lines[mid].first].offset <= offset) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+/*
+* 返回 chars[0..count] 中字节偏移不大于 offset 的最后一个字符的下标（偏移落在多字节字符内部时取该字符），
+* 二分查找。chars[count] 为文本末尾。
+*/
+static int chars_index_of(const LayoutChar *chars, int count, int offset) {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (chars[mid].offset <= offset) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+/* 在光标位置 chars[first..last] 中返回距离笔位 px 最近的一个，二分查找 */
+static int chars_nearest(const LayoutChar *chars, int first, int last, float px) {
+    int lo = first, hi = last;
+    while (lo < hi) {       /* 找笔位不大于 px 的最后一个位置 */
+        int mid = (lo + hi + 1) / 2;
+        if (chars[mid].x <= px) lo = mid;
+        else hi = mid - 1;
+    }
+    if (lo < last && px - chars[lo].x > (chars[lo + 1].x - chars[lo].x) / 2) lo++;
+    return lo;
+}
+
+/* 返回字符下标 index 所在的行，二分查找 */
+static int layout_line_of_char(const lcd_layout_t *layout, int index) {
+    int lo = 0, hi = layout->line_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (layout->lines[mid].first <= index) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+/* 点击位置转换为字节偏移 */
+int lcd_layout_hit_test(const lcd_layout_t *layout, int x, int y) {
+    /*
+    * 功能：(x, y) 为相对排版左上角的点击坐标，返回距离最近的字符边界（光标位置）的字节偏移。
+    *      y 超出范围时取第一行或最后一行，x 超出行尾时取行尾。
+    * 逻辑：按行距求出行号，再在该行字符的笔位中二分查找 x 所在的字符，落在字符右半部分时取其后的边界。
+    *      以 \n 结尾的行，行尾是 \n 之前；自动换行的行，行尾与下一行行首是同一个偏移。
+    */
+    if (!layout) return 0;
+
+    int r = y < 0 ? 0 : y / layout->line_height;
+    if (r >= layout->line_count) r = layout->line_count - 1;
+    const LayoutLine *line = &layout->lines[r];
+    const LayoutChar *chars = layout->chars;
+
+    int last = line->end;   /* 本行最后一个光标位置 */
+    if (last > line->first && chars[last - 1].codepoint == '\n') last--;
+
+    return chars[chars_nearest(chars, line->first, last, chars[line->first].x + x)].offset;
+}
+
+/* 字节偏移转换为光标坐标 */
+int lcd_layout_caret_x(const lcd_layout_t *layout, int offset, int *y) {
+    /*
+    * 功能：返回字节偏移 offset 处光标相对排版左边界的 x 坐标，y 不为 NULL 时存入光标所在行的上边界。
+    *      offset 落在多字节字符内部时取该字符之前。
+    */
+    if (!layout) return 0;
+
+    int k = chars_index_of(layout->chars, layout->char_count, offset);
+    int r = layout_line_of_char(layout, k);
+    if (y) *y = r * layout->line_height;
+    return (int)floor(layout->chars[k].x - layout->chars[layout->lines[r].first].x + 0.5f);
+}
+
+/* 绘制排版结果 */
+void lcd_layout_draw(const lcd_layout_t *layout, int x, int y, int width, int height, color_t color) {
+    /*
+    * 功能：把排版结果绘制到以 (x, y) 为左上角、width x height 的框内，超出框的部分被裁剪。
+    * 逻辑：只绘制与框（及当前裁剪矩形）相交的行，每个字形经字形缓存渲染并裁剪到框内。
+    */
+    if (!layout || !lcd) return;
+
+    int x0 = x, y0 = y, x1 = x + width, y1 = y + height;
+    if (!clip_to_target(&x0, &y0, &x1, &y1)) return;
+
+    int row0 = (y0 - y) / layout->line_height;
+    for (int r = row0 < 0 ? 0 : row0; r < layout->line_count; r++) {
+        int top = y + r * layout->line_height;
+        if (top >= y1) break;
+        layout_draw_line(layout, r, x, top, color, x0, y0, x1, y1);
+    }
+}
+
+/*
+* 长文档视图
+* 文件以只读方式映射到内存，按段落（以 \n 分隔）排版，只排版视口附近的段落并缓存最近使用的段落排版结果。
+* 超长段落（或没有换行的文件）按固定的字节网格切分：DOC_BLOCK_SIZE 的整数倍处（向后对齐到 UTF-8 字符边界），
+* 若所在段落在此之前已有 DOC_BLOCK_SIZE 字节，则该处也是段落起点，切分处强制换行。短段落不受影响；
+* 任一段落不超过约两个网格间隔，向前查找段落起点的回扫也有同样的上限，排版的开销与段落长度无关。
+* 视口位置记为（段落起始字节偏移，段落内的行号），滚动只在相邻段落之间移动，与文档大小无关。
+* 行号索引是稀疏的：从文档开头按需向后推进，每隔至少 DOC_INDEX_STRIDE 字节在段落起点（含切分点）记录一个
+* （字节偏移，行号）检查点，按行号或字节偏移定位时先二分查找检查点，再向后排版不超过一个间隔的段落。
+*/
+#define DOC_CACHE_SIZE      64      /* 缓存的段落排版数量 */
+#define DOC_INDEX_STRIDE    2048    /* 行号索引检查点的最小间隔（字节） */
+#define DOC_BLOCK_SIZE      4096    /* 超长段落的切分网格间隔（字节） */
+
+/* 行号索引检查点：段落起始字节偏移与该段落第一行的行号 */
+typedef struct {
+    size_t offset;
+    int line;
+} DocCheckpoint;
+
+/* 缓存的段落排版 */
+typedef struct {
+    size_t offset;          /* 段落起始字节偏移 */
+    size_t next;            /* 下一段落的起始字节偏移，等于文档大小表示没有下一段落 */
+    lcd_layout_t *layout;   /* 段落排版结果（不含结尾的 \n），为 NULL 表示该项空闲 */
+    unsigned int last_used; /* 最近使用时刻 */
+} DocParagraph;
+
+struct lcd_document {
+    const char *text;       /* 映射的文件内容，空文件为 NULL */
+    size_t size;            /* 文件大小 */
+    int font_size;          /* 字体大小 */
+    int max_width;          /* 最大行宽 */
+    int line_spacing;       /* 行间距 */
+    DocParagraph cache[DOC_CACHE_SIZE];     /* 段落排版缓存 */
+    unsigned int tick;      /* 缓存使用计数 */
+    size_t top;             /* 视口第一行所在段落的起始字节偏移 */
+    int top_sub;            /* 视口第一行在段落内的行号 */
+    DocCheckpoint *index;   /* 行号索引检查点，按偏移递增 */
+    int index_count;        /* 检查点数量 */
+    int index_capacity;     /* 检查点数组容量 */
+    size_t indexed_offset;  /* 行号索引已推进到的段落起点 */
+    int indexed_lines;      /* 该段落第一行的行号 */
+};
+
+/* 网格点 k * DOC_BLOCK_SIZE 向后对齐到 UTF-8 字符边界（跳过至多 3 个后续字节） */
+static size_t doc_grid(const lcd_document_t *doc, size_t k) {
+    size_t offset = k * DOC_BLOCK_SIZE;
+    for (int n = 0; n < 3 && offset < doc->size && ((unsigned char)doc->text[offset] & 0xC0) == 0x80; n++) offset++;
+    return offset;
+}
+
+/*
+* 网格点 grid 是否为切分点：它不在文档首尾、本身不是 \n，且之前 DOC_BLOCK_SIZE 字节内没有 \n，
+* 即所在段落在此之前已至少有 DOC_BLOCK_SIZE 字节。短段落跨过网格点时不切分。
+*/
+static int doc_grid_split(const lcd_document_t *doc, size_t grid) {
+    if (grid < DOC_BLOCK_SIZE || grid >= doc->size || doc->text[grid] == '\n') return 0;
+    for (size_t p = grid - DOC_BLOCK_SIZE; p < grid; p++) {
+        if (doc->text[p] == '\n') return 0;
+    }
+    return 1;
+}
+
+/*
+* 返回起始于 offset 的段落的结束位置，*next 为下一段落的起点
+* 逻辑：逐个网格间隔查找 \n：找到时段落在 \n 处结束；到达切分点时在切分点结束（*next 等于结束位置）。
+*      起点之后的第二个网格点之前的 DOC_BLOCK_SIZE 字节都已确认没有 \n，必为切分点，段落最长约两个网格间隔。
+*/
+static size_t doc_paragraph_end(const lcd_document_t *doc, size_t offset, size_t *next) {
+    size_t k = offset / DOC_BLOCK_SIZE;
+    if (doc_grid(doc, k) <= offset) k++;
+    for (size_t from = offset; ; k++) {
+        size_t grid = doc_grid(doc, k);
+        size_t limit = grid < doc->size ? grid + 1 : doc->size;     /* 查找范围包含网格点本身 */
+        const char *end = limit > from ? (const char*)memchr(doc->text + from, '\n', limit - from) : NULL;
+        if (end) {
+            *next = (size_t)(end - doc->text) + 1;
+            return (size_t)(end - doc->text);
+        }
+        if (grid >= doc->size) {
+            *next = doc->size;
+            return doc->size;
+        }
+        if (doc_grid_split(doc, grid)) {
+            *next = grid;
+            return grid;
+        }
+        from = limit;
+    }
+}
+
+/* 排版起始于 offset 的段落 */
+static lcd_layout_t *doc_layout(const lcd_document_t *doc, size_t offset, size_t end) {
+    const char *text = doc->text ? doc->text + offset : "";
+    return layout_build(text, (int)(end - offset), doc->font_size, doc->max_width, doc->line_spacing);
+}
+
+/* 取起始于 offset 的段落排版，未缓存时排版后替换最久未使用的缓存项，失败返回 NULL */
+static const DocParagraph *doc_paragraph(lcd_document_t *doc, size_t offset) {
+    DocParagraph *victim = &doc->cache[0];
+    for (int k = 0; k < DOC_CACHE_SIZE; k++) {
+        DocParagraph *p = &doc->cache[k];
+        if (p->layout && p->offset == offset) {
+            p->last_used = ++doc->tick;
+            return p;
+        }
+        if (!p->layout || (victim->layout && p->last_used < victim->last_used)) victim = p;
+    }
+
+    size_t next;
+    size_t end = doc_paragraph_end(doc, offset, &next);
+    lcd_layout_t *layout = doc_layout(doc, offset, end);
+    if (!layout) return NULL;
+
+    lcd_layout_destroy(victim->layout);
+    victim->offset = offset;
+    victim->next = next;
+    victim->layout = layout;
+    victim->last_used = ++doc->tick;
+    return victim;
+}
+
+/*
+* 返回 offset 所在段落的起点：offset 之前（不含）最后一个 \n 之后的位置与不超过 offset 的切分点中较大者
+* 逻辑：向前回扫，经过网格点时检查它是否为切分点。不是切分点的网格点之前 DOC_BLOCK_SIZE 字节内必有 \n，
+*      回扫最多经过两个网格点，长度不超过约两个网格间隔。
+*/
+static size_t doc_paragraph_start(const lcd_document_t *doc, size_t offset) {
+    size_t k = offset / DOC_BLOCK_SIZE;
+    size_t grid = doc_grid(doc, k);
+    if (grid > offset) grid = k > 0 ? doc_grid(doc, --k) : 0;
+    for (;;) {
+        if (offset == grid && doc_grid_split(doc, grid)) return offset;
+        if (offset == 0 || doc->text[offset - 1] == '\n') return offset;
+        offset--;
+        if (offset < grid) grid = k > 0 ? doc_grid(doc, --k) : 0;
+    }
+}
+
+/* 关闭长文档视图 */
+void lcd_document_close(lcd_document_t *doc) {
+    if (doc) {
+        for (int k = 0; k < DOC_CACHE_SIZE; k++) lcd_layout_destroy(doc->cache[k].layout);
+        if (doc->text) munmap((void*)doc->text, doc->size);
+        free(doc->index);
+        free(doc);
+    }
+}
+
+/* 打开长文档视图 */
+lcd_document_t *lcd_document_open(const char *path, int font_size, int max_width, int line_spacing) {
+    /*
+    * 功能：以只读方式映射文本文件 path，创建按 max_width 自动换行的文档视图，视口位于文档开头。失败返回 NULL。
+    * 逻辑：打开时不做任何排版，只映射文件并记录第一个行号检查点。
+    */
+    if (!path || !lcd || max_width <= 0) return NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        perror("open");
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        perror("fstat");
+        close(fd);
+        return NULL;
+    }
+
+    lcd_document_t *doc = (lcd_document_t*)calloc(1, sizeof(lcd_document_t));
+    if (!doc) {
+        perror("malloc");
+        close(fd);
+        return NULL;
+    }
+    doc->size = st.st_size;
+    if (doc->size > 0) {
+        void *map = mmap(0, doc->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            perror("mmap");
+            close(fd);
+            free(doc);
+            return NULL;
+        }
+        doc->text = (const char*)map;
+    }
+    close(fd);  /* 映射建立后不再需要文件描述符 */
+
+    doc->font_size = font_size;
+    doc->max_width = max_width;
+    doc->line_spacing = line_spacing;
+    doc->index = (DocCheckpoint*)malloc(16 * sizeof(DocCheckpoint));
+    if (!doc->index) {
+        perror("malloc");
+        lcd_document_close(doc);
+        return NULL;
+    }
+    doc->index_capacity = 16;
+    doc->index[0].offset = 0;
+    doc->index[0].line = 0;
+    doc->index_count = 1;
+    return doc;
+}
+
+/*
+* 推进行号索引一个段落
+* 逻辑：统计索引前沿处段落的行数（已缓存时直接使用，否则临时排版后释放，不挤占视口的缓存），
+*      前沿距上一个检查点超过 DOC_INDEX_STRIDE 字节时记录新的检查点。已到文档末尾或失败时返回 -1。
+*/
+static int doc_index_step(lcd_document_t *doc) {
+    if (doc->indexed_offset >= doc->size) return -1;
+
+    const DocCheckpoint *last = &doc->index[doc->index_count - 1];
+    if (doc->indexed_offset - last->offset >= DOC_INDEX_STRIDE) {
+        if (doc->index_count == doc->index_capacity) {
+            DocCheckpoint *index = (DocCheckpoint*)realloc(doc->index, doc->index_capacity * 2 * sizeof(DocCheckpoint));
+            if (!index) {
+                perror("malloc");
+                return -1;
+            }
+            doc->index = index;
+            doc->index_capacity *= 2;
+        }
+        doc->index[doc->index_count].offset = doc->indexed_offset;
+        doc->index[doc->index_count].line = doc->indexed_lines;
+        doc->index_count++;
+    }
+
+    size_t next;
+    size_t end = doc_paragraph_end(doc, doc->indexed_offset, &next);
+    int lines = -1;
+    for (int k = 0; k < DOC_CACHE_SIZE; k++) {
+        if (doc->cache[k].layout && doc->cache[k].offset == doc->indexed_offset) {
+            lines = doc->cache[k].layout->line_count;
+            break;
+        }
+    }
+    if (lines < 0) {
+        lcd_layout_t *layout = doc_layout(doc, doc->indexed_offset, end);
+        if (!layout) return -1;
+        lines = layout->line_count;
+        lcd_layout_destroy(layout);
+    }
+    doc->indexed_lines += lines;
+    doc->indexed_offset = next;
+    return 0;
+}
+
+/* 返回字节偏移不超过 offset（key_is_line 为 1 时比较行号 line）的最后一个检查点，二分查找 */
+static const DocCheckpoint *doc_checkpoint(const lcd_document_t *doc, size_t offset, int line, int key_is_line) {
+    int lo = 0, hi = doc->index_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        int before = key_is_line ? doc->index[mid].line <= line : doc->index[mid].offset <= offset;
+        if (before) lo = mid;
+        else hi = mid - 1;
+    }
+    return &doc->index[lo];
+}
+
+/* 滚动视口 */
+int lcd_document_scroll(lcd_document_t *doc, int lines) {
+    /*
+    * 功能：视口向下（lines > 0）或向上（lines < 0）滚动 lines 行，到达文档首尾时停止，返回实际滚动的行数。
+    * 逻辑：在段落内移动行号，越过段落边界时取相邻段落的排版（通常已缓存），每行开销与文档大小无关。
+    */
+    if (!doc) return 0;
+
+    int moved = 0;
+    while (moved < lines) {
+        const DocParagraph *p = doc_paragraph(doc, doc->top);
+        if (!p) break;
+        if (doc->top_sub + 1 < p->layout->line_count) {
+            doc->top_sub++;
+        } else if (p->next < doc->size) {
+            doc->top = p->next;
+            doc->top_sub = 0;
+        } else {
+            break;
+        }
+        moved++;
+    }
+    while (moved > lines) {
+        if (doc->top_sub > 0) {
+            doc->top_sub--;
+        } else if (doc->top > 0) {
+            size_t prev = doc_paragraph_start(doc, doc->top - 1);
+            const DocParagraph *p = doc_paragraph(doc, prev);
+            if (!p) break;
+            doc->top = prev;
+            doc->top_sub = p->layout->line_count - 1;
+        } else {
+            break;
+        }
+        moved--;
+    }
+    return moved;
+}
+
+/* 视口跳转到字节偏移 offset 所在的行 */
+void lcd_document_seek(lcd_document_t *doc, size_t offset) {
+    if (!doc) return;
+    if (offset > doc->size) offset = doc->size;
+
+    size_t start = doc_paragraph_start(doc, offset);
+    if (start == doc->size && start > 0) start = doc_paragraph_start(doc, start - 1);   /* 文档以 \n 结尾 */
+    const DocParagraph *p = doc_paragraph(doc, start);
+    if (!p) return;
+    doc->top = start;
+    doc->top_sub = layout_line_of(p->layout, (int)(offset - start));
+}
+
+/* 视口跳转到第 line 行（从 0 开始），超过文档行数时跳转到最后一行 */
+void lcd_document_goto_line(lcd_document_t *doc, int line) {
+    /*
+    * 逻辑：行号索引尚未覆盖 line 时先向后推进；随后二分查找不超过 line 的检查点，
+    *      从检查点向后逐段落累加行数，最多经过一个检查点间隔。
+    */
+    if (!doc) return;
+    if (line < 0) line = 0;
+
+    while (doc->indexed_lines <= line && doc_index_step(doc) == 0) {
+    }
+
+    const DocCheckpoint *cp = doc_checkpoint(doc, 0, line, 1);
+    size_t offset = cp->offset;
+    int first = cp->line;
+    for (;;) {
+        const DocParagraph *p = doc_paragraph(doc, offset);
+        if (!p) return;
+        int count = p->layout->line_count;
+        if (line < first + count || p->next >= doc->size) {
+            doc->top = offset;
+            doc->top_sub = line - first < count ? line - first : count - 1;
+            return;
+        }
+        first += count;
+        offset = p->next;
+    }
+}
+
+/* 返回视口第一行的行号（从 0 开始） */
+int lcd_document_top_line(lcd_document_t *doc) {
+    if (!doc) return 0;
+
+    while (doc->indexed_offset <= doc->top && doc_index_step(doc) == 0) {
+    }
+
+    const DocCheckpoint *cp = doc_checkpoint(doc, doc->top, 0, 0);
+    size_t offset = cp->offset;
+    int line = cp->line;
+    while (offset < doc->top) {
+        const DocParagraph *p = doc_paragraph(doc, offset);
+        if (!p) break;
+        line += p->layout->line_count;
+        offset = p->next;
+    }
+    return line + doc->top_sub;
+}
+
+/* 绘制视口 */
+void lcd_document_draw(lcd_document_t *doc, int x, int y, int width, int height, color_t color) {
+    /*
+    * 功能：从视口第一行开始，把文档绘制到以 (x, y) 为左上角、width x height 的框内，超出框的部分被裁剪。
+    *      不清除背景，滚动后由调用者先填充框的背景。
+    * 逻辑：依次取视口所在及之后的段落排版，逐行绘制直到框底，只有这些段落参与排版。
+    */
+    if (!doc || !lcd) return;
+
+    int x0 = x, y0 = y, x1 = x + width, y1 = y + height;
+    if (!clip_to_target(&x0, &y0, &x1, &y1)) return;
+
+    size_t offset = doc->top;
+    int sub = doc->top_sub;
+    int top = y;
+    while (top < y1) {
+        const DocParagraph *p = doc_paragraph(doc, offset);
+        if (!p) return;
+        const lcd_layout_t *layout = p->layout;
+        for (; sub < layout->line_count && top < y1; sub++) {
+            if (top + layout->line_height > y0) layout_draw_line(layout, sub, x, top, color, x0, y0, x1, y1);
+            top += layout->line_height;
+        }
+        if (p->next >= doc->size) break;
+        offset = p->next;
+        sub = 0;
+    }
+}
+
+/*
+* 流式文本输出
+* 把任意切分的字节流（如进程输出、tail -f 的文件描述符）直接显示到屏幕区域。
+* 输出对象只保存光标位置与未解码完的 UTF-8 字节，屏幕像素本身就是已输出的内容：
+* 每个新字符只在光标处渲染一次，超出行宽自动换行，超出最后一行时用 lcd_copy_area 上滚一行。
+* 输出过程不回看已输出的内容，也不分配内存。
+*/
+#define STREAM_TAB_WIDTH    8       /* 制表符对齐的空格数 */
+#define STREAM_READ_BUF     4096    /* lcd_stream_read_fd 每次读取的最大字节数 */
+
+struct lcd_stream {
+    int x, y;                   /* 输出区域左上角坐标 */
+    int width, height;          /* 输出区域尺寸 */
+    int font_size;              /* 字体大小 */
+    float scale;                /* 字体缩放比例 */
+    int line_height;            /* 行高 */
+    int baseline;               /* 基线相对行上边界的偏移 */
+    int rows;                   /* 可显示的行数 */
+    color_t fg, bg;             /* 文本颜色与背景颜色 */
+    int row;                    /* 光标所在行 */
+    float pen;                  /* 光标笔位，相对区域左边界 */
+    int prev;                   /* 本行上一个字符的字形键，用于字距调整，行首为 0 */
+    int cr_pending;             /* 收到 \r 后为 1：下一个可见字符前先清除本行 */
+    unsigned char carry[4];     /* 跨块的不完整 UTF-8 序列 */
+    int carry_len;              /* carry 中已有的字节数 */
+    int carry_need;             /* 该序列的总字节数 */
+};
+
+/* 根据 UTF-8 首字节返回序列长度，非法首字节返回 1（解码为 U+FFFD） */
+static int utf8_sequence_length(unsigned char c) {
+    if (c < 0x80) return 1;
+    if (c >= 0xC2 && c <= 0xDF) return 2;
+    if ((c & 0xF0) == 0xE0) return 3;
+    if (c >= 0xF0 && c <= 0xF4) return 4;
+    return 1;
+}
+
+/* 创建流式文本输出，区域先填充为背景色 */
+lcd_stream_t *lcd_stream_create(int x, int y, int width, int height, int font_size,
+                                color_t fg, color_t bg) {
+    if (!lcd || width <= 0 || height <= 0) return NULL;
+
+    lcd_stream_t *stream = (lcd_stream_t*)calloc(1, sizeof(lcd_stream_t));
+    if (!stream) {
+        perror("malloc");
+        return NULL;
+    }
+
+    int ascent, descent;
+    stbtt_GetFontVMetrics(font, &ascent, &descent, 0);
+    stream->scale = stbtt_ScaleForPixelHeight(font, font_size);
+    stream->line_height = (int)((ascent - descent) * stream->scale);
+    stream->baseline = (int)(ascent * stream->scale);
+    if (stream->line_height <= 0) stream->line_height = 1;
+    stream->rows = height / stream->line_height;
+    if (stream->rows <= 0) stream->rows = 1;
+
+    stream->x = x;
+    stream->y = y;
+    stream->width = width;
+    stream->height = height;
+    stream->font_size = font_size;
+    stream->fg = fg;
+    stream->bg = bg;
+    fill_rect(x, y, x + width, y + height, bg);
+    return stream;
+}
+
+/* 销毁流式文本输出，不改变屏幕内容 */
+void lcd_stream_destroy(lcd_stream_t *stream) {
+    free(stream);
+}
+
+/* 清空输出区域，光标回到左上角 */
+void lcd_stream_clear(lcd_stream_t *stream) {
+    if (!stream || !lcd) return;
+    fill_rect(stream->x, stream->y, stream->x + stream->width, stream->y + stream->height, stream->bg);
+    stream->row = 0;
+    stream->pen = 0;
+    stream->prev = 0;
+    stream->cr_pending = 0;
+}
+
+/* 清除光标所在行 */
+static void stream_clear_row(const lcd_stream_t *stream) {
+    int top = stream->y + stream->row * stream->line_height;
+    fill_rect(stream->x, top, stream->x + stream->width, top + stream->line_height, stream->bg);
+}
+
+/* 换行，已在最后一行时区域上滚一行并清除新露出的行 */
+static void stream_newline(lcd_stream_t *stream) {
+    stream->pen = 0;
+    stream->prev = 0;
+    stream->cr_pending = 0;
+    if (stream->row < stream->rows - 1) {
+        stream->row++;
+        return;
+    }
+    if (stream->rows > 1) {
+        lcd_copy_area(stream->x, stream->y + stream->line_height, stream->width,
+                      (stream->rows - 1) * stream->line_height, stream->x, stream->y);
+    }
+    stream_clear_row(stream);
+}
+
+/* 输出一个字符：处理控制字符，可见字符在光标处渲染，放不下时先换行 */
+static void stream_put(lcd_stream_t *stream, int codepoint) {
+    if (codepoint == '\n') {
+        stream_newline(stream);
+        return;
+    }
+    if (codepoint == '\r') {
+        stream->pen = 0;
+        stream->prev = 0;
+        stream->cr_pending = 1;     /* 紧跟 \n 时不清除刚输出的行 */
+        return;
+    }
+    if (codepoint == '\t') {
+        int advance, lsb;
+        stbtt_GetCodepointHMetrics(font, ' ', &advance, &lsb);
+        float tab = advance * stream->scale * STREAM_TAB_WIDTH;
+        if (tab <= 0) return;
+        if (stream->cr_pending) {
+            stream_clear_row(stream);
+            stream->cr_pending = 0;
+        }
+        stream->pen = (floor(stream->pen / tab) + 1) * tab;
+        stream->prev = 0;
+        if (stream->pen >= stream->width) stream_newline(stream);
+        return;
+    }
+    if (codepoint < 32) return;     /* 跳过其他控制字符 */
+
+    if (stream->cr_pending) {
+        stream_clear_row(stream);
+        stream->cr_pending = 0;
+    }
+
+    int key = font_key(codepoint);
+    float advance = key_advance(key);
+    float pen = stream->pen;
+    if (stream->prev) pen += stream->scale * key_kern(stream->prev, key);
+    if (pen + advance * stream->scale > stream->width && stream->pen > 0) {
+        stream_newline(stream);
+        pen = 0;
+    }
+
+    int top = stream->y + stream->row * stream->line_height;
+    render_glyph(key, stream->x + pen, top + stream->baseline, stream->font_size, stream->fg,
+                 stream->x, top, stream->x + stream->width, top + stream->line_height);
+    stream->pen = pen + advance * stream->scale;
+    stream->prev = key;
+}
+
+/*
+* 丢弃不完整的序列 carry
+* 合法前缀替换为一个 U+FFFD；第二个字节已判定序列不合法时（超长编码、代理区等），
+* 首字节与各后续字节各替换为一个 U+FFFD，与 decode_utf8 的处理一致。
+*/
+static void stream_drop_carry(lcd_stream_t *stream) {
+    int codepoint;
+    int used = decode_utf8((const char*)stream->carry, stream->carry_len, &codepoint);
+    int count = used < stream->carry_len ? stream->carry_len : 1;
+    stream->carry_len = 0;
+    while (count-- > 0) stream_put(stream, 0xFFFD);
+}
+
+/* 输出一块字节 */
+void lcd_stream_write(lcd_stream_t *stream, const char *data, size_t len) {
+    /*
+    * 功能：输出 len 字节的 UTF-8 数据，块边界可以切断多字节序列。
+    * 逻辑：上一块末尾不完整的序列保存在 carry 中，先用本块开头的字节补全；序列中出现非后续字节时
+    *      输出 U+FFFD 并从该字节重新开始。完整位于本块内的序列直接解码，末尾不完整的序列存入 carry。
+    */
+    if (!stream || !data || !lcd) return;
+
+    size_t i = 0;
+    while (i < len) {
+        unsigned char c = (unsigned char)data[i];
+
+        if (stream->carry_len > 0) {
+            if ((c & 0xC0) != 0x80) {   /* 序列被截断 */
+                stream_drop_carry(stream);
+                continue;
+            }
+            stream->carry[stream->carry_len++] = c;
+            i++;
+            int codepoint;
+            int used = decode_utf8((const char*)stream->carry, stream->carry_len, &codepoint);
+            if (used < stream->carry_len) {     /* 第二个字节已判定序列不合法 */
+                stream_drop_carry(stream);
+            } else if (stream->carry_len == stream->carry_need) {
+                stream->carry_len = 0;
+                stream_put(stream, codepoint);
+            }
+            continue;
+        }
+
+        int need = utf8_sequence_length(c);
+        if (need > 1 && i + need > len) {   /* 序列跨越块边界 */
+            stream->carry_need = need;
+            while (i < len) {
+                if (stream->carry_len > 0 && ((unsigned char)data[i] & 0xC0) != 0x80) break;
+                stream->carry[stream->carry_len++] = data[i++];
+            }
+            if (i < len) {              /* 块内已出现非后续字节，序列不完整 */
+                stream_drop_carry(stream);
+            }
+            continue;
+        }
+
+        int codepoint;
+        i += decode_utf8(&data[i], len - i, &codepoint);   /* 不完整的序列解码为 U+FFFD */
+        stream_put(stream, codepoint);
+    }
+}
+
+/* 从文件描述符读取一次并输出 */
+ssize_t lcd_stream_read_fd(lcd_stream_t *stream, int fd) {
+    /*
+    * 功能：从 fd 读取至多 STREAM_READ_BUF 字节并输出，返回 read 的结果（0 表示文件结束，-1 表示出错）。
+    *      fd 为非阻塞时可在界面循环中反复调用。读取缓冲区在栈上，不分配内存。
+    */
+    char buf[STREAM_READ_BUF];
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n > 0) lcd_stream_write(stream, buf, n);
+    return n;
+}
+
+/*
+* 可编辑文本框
+* 单行文本框保存文本与每个字符的累计笔位（与段落排版相同的 LayoutChar）。插入、删除时只对编辑点处的
+* 字符及其前后两个字距调整对重新计算笔位，之后的字符整体平移；屏幕上只重绘从编辑点到行尾的部分，
+* 编辑点之前的字符不重新渲染。超出文本框宽度的部分被裁剪。
+*/
+struct lcd_edit {
+    int x, y;               /* 文本框左上角坐标 */
+    int width, height;      /* 文本框尺寸，高度由字体大小决定 */
+    int font_size;          /* 字体大小 */
+    float scale;            /* 字体缩放比例 */
+    int baseline;           /* 基线相对上边界的偏移 */
+    color_t fg, bg;         /* 文本颜色与背景颜色 */
+    char *text;             /* 文本，以 '\0' 结尾 */
+    int len;                /* 文本字节数 */
+    int text_capacity;      /* text 的容量 */
+    LayoutChar *chars;      /* count + 1 个字符，最后一项的 x 与 offset 为文本末尾 */
+    int count;              /* 字符数量 */
+    int char_capacity;      /* chars 的容量 */
+    int valid;              /* 为 0 时表示屏幕内容不可信，下一次编辑时整体重绘 */
+};
+
+/* 保证文本与字符数组的容量，失败返回 -1 */
+static int edit_reserve(lcd_edit_t *edit, int len, int count) {
+    if (len + 1 > edit->text_capacity) {    /* 末尾留出 '\0' */
+        int capacity = edit->text_capacity * 2 > len + 1 ? edit->text_capacity * 2 : len + 1;
+        char *text = (char*)realloc(edit->text, capacity);
+        if (!text) {
+            perror("malloc");
+            return -1;
+        }
+        edit->text = text;
+        edit->text_capacity = capacity;
+    }
+    if (count + 1 > edit->char_capacity) {
+        int capacity = edit->char_capacity * 2 > count + 1 ? edit->char_capacity * 2 : count + 1;
+        LayoutChar *chars = (LayoutChar*)realloc(edit->chars, capacity * sizeof(LayoutChar));
+        if (!chars) {
+            perror("malloc");
+            return -1;
+        }
+        edit->chars = chars;
+        edit->char_capacity = capacity;
+    }
+    return 0;
+}
+
+/* 返回码点的前进宽度，控制字符为 0 */
+static float edit_advance(const lcd_edit_t *edit, int codepoint) {
+    if (codepoint < 32) return 0;
+    return key_advance(font_key(codepoint)) * edit->scale;
+}
+
+/* 返回码点 a 与 b 之间的字距调整，任一方为控制字符或文本末尾时为 0 */
+static float edit_kern(const lcd_edit_t *edit, int a, int b) {
+    if (a < 32 || b < 32) return 0;
+    return edit->scale * key_kern(font_key(a), font_key(b));
+}
+
+/* 返回字符下标 k 处字形墨迹的左边界（相对文本框左边界），没有字形时为笔位 */
+static float edit_ink_left(const lcd_edit_t *edit, int k) {
+    const LayoutChar *c = &edit->chars[k];
+    if (k >= edit->count || c->codepoint < 32) return c->x;
+    int x0, y0, x1, y1;
+    key_bitmap_box(font_key(c->codepoint), edit->scale, 0, &x0, &y0, &x1, &y1);
+    return x1 > x0 && x0 < 0 ? c->x + x0 : c->x;
+}
+
+/*
+* 重新计算笔位
+* 逻辑：字符 k .. k + n（含编辑点之后第一个未变化的字符）依次由前一个字符的笔位、前进宽度和字距调整求出，
+*      之后的字符（含文本末尾）平移同样的距离，不再查询字体度量。
+*/
+static void edit_reflow(lcd_edit_t *edit, int k, int n) {
+    LayoutChar *chars = edit->chars;
+    float pen = 0;
+    if (k > 0) {
+        pen = chars[k - 1].x + chars[k - 1].advance;
+        if (k < edit->count) pen += edit_kern(edit, chars[k - 1].codepoint, chars[k].codepoint);
+    }
+    int last = k + n < edit->count ? k + n : edit->count;
+    for (int j = k; j < last; j++) {
+        chars[j].x = pen;
+        chars[j].advance = edit_advance(edit, chars[j].codepoint);
+        pen += chars[j].advance;
+        if (j + 1 < edit->count) pen += edit_kern(edit, chars[j].codepoint, chars[j + 1].codepoint);
+    }
+    float delta = pen - chars[last].x;
+    for (int j = last; j <= edit->count; j++) chars[j].x += delta;
+}
+
+/*
+* 重绘从 left 到行尾的部分
+* 逻辑：清除 [left, width) 列后，重新渲染墨迹可能与该范围相交的字符（从笔位不大于 left 的字符的前一个开始，
+*      到笔位超出文本框宽度为止），字形裁剪到该范围内。
+*/
+static void edit_repaint(lcd_edit_t *edit, float left) {
+    int col = (int)floor(left);
+    if (col < 0) col = 0;
+    if (col >= edit->width) return;
+
+    int x0 = edit->x + col, x1 = edit->x + edit->width;
+    int y0 = edit->y, y1 = edit->y + edit->height;
+    fill_rect(x0, y0, x1, y1, edit->bg);
+
+    int lo = 0, hi = edit->count;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (edit->chars[mid].x <= col) lo = mid;
+        else hi = mid - 1;
+    }
+    for (int k = lo > 0 ? lo - 1 : 0; k < edit->count; k++) {
+        const LayoutChar *c = &edit->chars[k];
+        if (c->x >= edit->width) break;
+        if (c->codepoint <= ' ') continue;
+        render_glyph(font_key(c->codepoint), edit->x + c->x, edit->y + edit->baseline, edit->font_size, edit->fg,
+                     x0, y0, x1, y1);
+    }
+}
+
+/* 创建可编辑文本框，文本为空，区域先填充为背景色 */
+lcd_edit_t *lcd_edit_create(int x, int y, int width, int font_size, color_t fg, color_t bg) {
+    if (!lcd || width <= 0) return NULL;
+
+    lcd_edit_t *edit = (lcd_edit_t*)calloc(1, sizeof(lcd_edit_t));
+    if (!edit) {
+        perror("malloc");
+        return NULL;
+    }
+    if (edit_reserve(edit, 64, 64)) {
+        free(edit);
+        return NULL;
+    }
+    edit->text[0] = '\0';
+    memset(&edit->chars[0], 0, sizeof(LayoutChar));    /* 文本末尾 */
+
+    int ascent, descent;
+    stbtt_GetFontVMetrics(font, &ascent, &descent, 0);
+    edit->scale = stbtt_ScaleForPixelHeight(font, font_size);
+    edit->baseline = (int)(ascent * edit->scale);
+    edit->height = (int)((ascent - descent) * edit->scale);
+    edit->x = x;
+    edit->y = y;
+    edit->width = width;
+    edit->font_size = font_size;
+    edit->fg = fg;
+    edit->bg = bg;
+    edit_repaint(edit, 0);
+    edit->valid = 1;
+    return edit;
+}
+
+/* 销毁可编辑文本框，不改变屏幕内容 */
+void lcd_edit_destroy(lcd_edit_t *edit) {
+    if (edit) {
+        free(edit->text);
+        free(edit->chars);
+        free(edit);
+    }
+}
+
+/* 文本框区域被其他绘制覆盖后调用，下一次编辑时整体重绘 */
+void lcd_edit_invalidate(lcd_edit_t *edit) {
+    if (edit) edit->valid = 0;
+}
+
+/* 返回文本框当前的文本 */
+const char *lcd_edit_text(const lcd_edit_t *edit) {
+    return edit ? edit->text : "";
+}
+
+/* 插入文本 */
+int lcd_edit_insert(lcd_edit_t *edit, int offset, const char *text) {
+    /*
+    * 功能：在字节偏移 offset 处插入 UTF-8 文本 text（offset 落在多字节字符内部时取该字符之前），
+    *      返回插入内容之后的字节偏移（即新的光标位置），失败返回 -1。
+    * 逻辑：文本与字符数组在编辑点处腾出空间，新字符与编辑点之后的第一个字符重新计算笔位
+    *      （涉及编辑点前后两个字距调整对），其余字符整体平移；随后只重绘从编辑点到行尾的部分。
+    */
+    if (!edit || !text || !lcd) return -1;
+
+    int k = chars_index_of(edit->chars, edit->count, offset);
+    offset = edit->chars[k].offset;
+    int ins = strlen(text);
+    if (ins == 0) return offset;
+
+    /* 字符数不超过字节数，按字节数保证容量 */
+    if (edit_reserve(edit, edit->len + ins, edit->count + ins)) return -1;
+
+    float old_left = edit_ink_left(edit, k);
+
+    memmove(edit->text + offset + ins, edit->text + offset, edit->len - offset + 1);
+    memcpy(edit->text + offset, text, ins);
+    edit->len += ins;
+
+    int n = 0;      /* 插入的字符数 */
+    for (int i = 0; i < ins; n++) {
+        int codepoint;
+        i += decode_utf8(&text[i], ins - i, &codepoint);
+    }
+    memmove(&edit->chars[k + n], &edit->chars[k], (edit->count - k + 1) * sizeof(LayoutChar));
+    int pos = offset;
+    for (int j = 0; j < n; j++) {
+        LayoutChar *c = &edit->chars[k + j];
+        c->offset = pos;
+        pos += decode_utf8(&edit->text[pos], offset + ins - pos, &c->codepoint);
+    }
+    edit->count += n;
+    for (int j = k + n; j <= edit->count; j++) edit->chars[j].offset += ins;
+
+    edit_reflow(edit, k, n + 1);
+    float left = edit_ink_left(edit, k);
+    edit_repaint(edit, edit->valid ? (left < old_left ? left : old_left) : 0);
+    edit->valid = 1;
+    return offset + ins;
+}
+
+/* 删除文本 */
+int lcd_edit_delete(lcd_edit_t *edit, int offset, int len) {
+    /*
+    * 功能：删除字节范围 [offset, offset + len)，起点落在多字节字符内部时向前取整到字符起点，
+    *      终点向后取整到字符末尾，因此退格可写为 lcd_edit_delete(edit, caret - 1, 1)。
+    *      返回删除后的光标位置（删除范围的起点），失败返回 -1。
+    * 逻辑：移除对应的字节与字符后，编辑点处的字符重新计算笔位（新的字距调整对），其余字符整体平移，
+    *      只重绘从编辑点到行尾的部分。
+    */
+    if (!edit || !lcd || len < 0) return -1;
+
+    int k0 = chars_index_of(edit->chars, edit->count, offset < 0 ? 0 : offset);
+    int k1 = chars_index_of(edit->chars, edit->count, offset + len);
+    if (edit->chars[k1].offset < offset + len && k1 < edit->count) k1++;
+    int start = edit->chars[k0].offset;
+    if (k1 <= k0) return start;
+
+    float old_left = edit_ink_left(edit, k0);
+
+    int removed = edit->chars[k1].offset - start;
+    memmove(edit->text + start, edit->text + start + removed, edit->len - start - removed + 1);
+    edit->len -= removed;
+    memmove(&edit->chars[k0], &edit->chars[k1], (edit->count - k1 + 1) * sizeof(LayoutChar));
+    edit->count -= k1 - k0;
+    for (int j = k0; j <= edit->count; j++) edit->chars[j].offset -= removed;
+
+    edit_reflow(edit, k0, 1);
+    float left = edit_ink_left(edit, k0);
+    edit_repaint(edit, edit->valid ? (left < old_left ? left : old_left) : 0);
+    edit->valid = 1;
+    return start;
+}
+
+/* 替换全部文本并整体重绘 */
+void lcd_edit_set_text(lcd_edit_t *edit, const char *text) {
+    if (!edit || !text || !lcd) return;
+    edit->text[0] = '\0';
+    edit->len = 0;
+    edit->count = 0;
+    memset(&edit->chars[0], 0, sizeof(LayoutChar));
+    edit->valid = 0;    /* 插入时从左边界开始重绘 */
+    if (!*text || lcd_edit_insert(edit, 0, text) < 0) {
+        edit_repaint(edit, 0);
+        edit->valid = 1;
+    }
+}
+
+/* 点击位置（相对文本框左边界的 x）转换为最近的光标位置的字节偏移 */
+int lcd_edit_hit_test(const lcd_edit_t *edit, int x) {
+    if (!edit) return 0;
+    return edit->chars[chars_nearest(edit->chars, 0, edit->count, (float)x)].offset;
+}
+
+/* 返回字节偏移 offset 处光标相对文本框左边界的 x 坐标 */
+int lcd_edit_caret_x(const lcd_edit_t *edit, int offset) {
+    if (!edit) return 0;
+    return (int)floor(edit->chars[chars_index_of(edit->chars, edit->count, offset)].x + 0.5f);
+}
@@ -21,6 +21,8 @@ Log:1.Optimize code comments and remove some useless code.
 #define LCD_FONT_H
 
 #include <stdint.h> 
+#include <stddef.h>
+#include <sys/types.h>
 
 /* 定义 BoxStyle 枚举类型 */
 typedef enum {
@@ -52,6 +54,26 @@ typedef uint16_t color_t;
 /* RGB565 颜色转换 */
 #define RGB565(r, g, b) (((r & 0xF8) << 8) | ((g & 0xFC) << 3) | ((b & 0xF8) >> 3))
 
+/*
+* 绘图表面
+* 描述一块可绘制的像素内存。屏幕本身是一个 RGB565 表面，也可以创建离屏表面，
+* 预先绘制复杂控件后再快速复制到屏幕。A8 表面每像素 1 字节，保存灰度/覆盖度，
+* 绘制到 A8 表面时颜色按亮度转换为 0~255。
+* stride 为每行的像素数（不是字节数）。
+*/
+typedef enum {
+    LCD_FORMAT_RGB565,      /* 每像素 2 字节，RGB565 */
+    LCD_FORMAT_A8           /* 每像素 1 字节，灰度/覆盖度 */
+} lcd_format_t;
+
+typedef struct {
+    lcd_format_t format;    /* 像素格式 */
+    int width;              /* 表面宽度 */
+    int height;             /* 表面高度 */
+    int stride;             /* 每行像素数 */
+    void *pixels;           /* 像素内存 */
+} lcd_surface_t;
+
 /* 
 * 初始化 LCD 显示屏和字体系统 
 * 接收 LCD 设备文件路径和字体文件路径作为参数，成功返回 0，失败返回非 0 值。
@@ -59,6 +81,44 @@ typedef uint16_t color_t;
 int lcd_init(const char *lcd_path, const char *font_path);
 void lcd_cleanup(void);     /* 清理 LCD 显示屏和字体系统占用的资源 */
 
+/*
+* 字体注册表
+* lcd_font_load 登记字体文件中的第 index 个字体（.ttc 字体集合按序号选择，单个字体的文件为 0）并返回句柄，
+* 同一文件与序号重复登记时返回同一句柄。登记时不读取文件，字体在第一次使用时才解析。
+* lcd_font_release 释放句柄，字体不再被任何句柄和字体链引用时卸载。
+* lcd_set_font 选用当前字体（主字体），之后的文本函数都使用该字体，字体在此时解析，失败返回 -1 并保持原来的字体。
+* lcd_init 登记并选用 font_path 中的第一个字体。lcd_get_font 返回当前字体的句柄，用完后同样需要 lcd_font_release。
+* 已创建的文本槽、控制台、排版等对象按创建时的字体排版，切换字体后需重新创建。
+* lcd_cleanup 卸载全部字体，之前得到的句柄随之失效。
+*/
+typedef struct lcd_font lcd_font_t;
+
+lcd_font_t *lcd_font_load(const char *path, int index);
+void lcd_font_release(lcd_font_t *font);
+int lcd_set_font(lcd_font_t *font);
+lcd_font_t *lcd_get_font(void);
+
+/*
+* 字体热切换
+* lcd_font_swap 在后台线程中读取、解析字体，并按 prewarm_text 中的字符以 font_size 大小预热字形缓存，
+* 期间渲染继续使用当前字体。应用在两帧之间调用 lcd_font_swap_poll：加载未完成返回 0；完成时把预热的字形
+* 并入缓存、切换为主字体并返回 1；加载失败返回 -1 并保持原来的字体。被换下的字体在下一次调用
+* lcd_font_swap_poll 时释放，已创建的文本槽、控制台等对象应在此之前重新创建。同一时刻只有一个切换任务，
+* 任务未完成时 lcd_font_swap 返回 -1。编译时需链接 -lpthread。
+*/
+int lcd_font_swap(lcd_font_t *font, const char *prewarm_text, int font_size);
+int lcd_font_swap_poll(void);
+
+/*
+* 后备字体
+* lcd_add_fallback 在字体链末尾追加后备字体（连同主字体最多 16 个），lcd_add_fallback_font 按路径追加文件中的第一个字体。
+* 主字体中没有的字符（符号、部分拉丁标点等）依次在后备字体中查找，都没有时显示主字体的 .notdef；
+* 后备字体在第一次查找到它时才解析。成功返回 0，失败返回 -1。
+* 行高与基线以主字体为准，后备字体的字形按字高与主字体一致缩放。
+*/
+int lcd_add_fallback(lcd_font_t *font);
+int lcd_add_fallback_font(const char *font_path);
+
 /* 屏幕操作 */
 void lcd_clear(color_t color);      /* 清空屏幕为指定颜色 */
 void lcd_set_font_size(int size);   /* 设置字体大小 */
@@ -94,6 +154,133 @@ void lcd_render_text_with_box( const char *text,       /* 文本内容 */
 int lcd_get_text_width(const char *text);       /* 获取文本宽度，text 是要计算宽度的文本字符串 */
 int lcd_get_text_height(void);                  /* 当前字体的文本高度 */
 
+/*
+* 长度限定、UTF-32 与字形索引输入
+* 以下函数与上面同名函数的行为一致，只是文本的给出方式不同，适用于协议缓冲区切片、输入法输出等场合，
+* 调用者不需要先复制、补 '\0' 或重新编码。
+* _n 版本：text 是长度为 len 字节的 UTF-8 文本，不要求以 '\0' 结尾。
+* _u32 版本：codepoints 是 count 个预先解码的 Unicode 码点，超出 Unicode 范围的码点按 U+FFFD 处理。
+* lcd_render_glyphs / lcd_get_glyphs_width：glyphs 是 count 个当前字体的字形索引（调用者预先完成字符映射），
+                                           字形之间照常进行字距调整。
+* lcd_glyph_index：返回码点在当前字体中的字形索引，字体中没有该字符时返回 0（.notdef）。
+*/
+void lcd_render_text_n(const char *text, int len,                   /* 文本内容与字节数 */
+                       int x, int y, color_t text_color, int font_size);
+void lcd_render_text_u32(const uint32_t *codepoints, int count,     /* 码点数组与码点数量 */
+                         int x, int y, color_t text_color, int font_size);
+void lcd_render_glyphs(const uint16_t *glyphs, int count,           /* 字形索引数组与数量 */
+                       int x, int y, color_t text_color, int font_size);
+void lcd_render_text_with_box_n(const char *text, int len,
+                                int x, int y, color_t text_color, color_t box_color, int padding,
+                                BoxStyle style, int radius, int font_size, int box_width, int box_height);
+void lcd_render_text_with_box_u32(const uint32_t *codepoints, int count,
+                                  int x, int y, color_t text_color, color_t box_color, int padding,
+                                  BoxStyle style, int radius, int font_size, int box_width, int box_height);
+int lcd_get_text_width_n(const char *text, int len);
+int lcd_get_text_width_u32(const uint32_t *codepoints, int count);
+int lcd_get_glyphs_width(const uint16_t *glyphs, int count);
+int lcd_glyph_index(int codepoint);
+
+/*
+* 渲染缓存
+* 字形缓存按（码点，字体大小，亚像素偏移）缓存字形位图；字符串缓存按（文本，字体大小）缓存整串文字的
+* 覆盖度蒙版，重复渲染同一字符串只需一次混合，且更换颜色不需要重新光栅化。两级缓存均按最近最少使用淘汰。
+* 字符串第二次出现时才生成蒙版，每次都不同的字符串（时钟、计数器）不占用字符串缓存。
+* lcd_set_cache_budget：设置两级缓存的字节预算，默认分别为 512KB 和 256KB，为 0 时禁用对应缓存。
+*/
+void lcd_set_cache_budget(size_t glyph_bytes,   /* 字形缓存字节预算 */
+                          size_t text_bytes     /* 字符串缓存字节预算 */
+                         );
+
+/*
+* 字形缓存存储格式
+* LCD_GLYPH_A8：每像素 8 位覆盖度（默认）。
+* LCD_GLYPH_A4：覆盖度量化为 4 位，每字节两个像素，占用约为 A8 的一半。
+* LCD_GLYPH_A4_RLE：在 4 位量化的基础上对透明与完全覆盖的连续像素做游程编码，大字号字形占用更小。
+* 压缩格式在混合时直接解码，不需要临时缓冲区；透明游程整段跳过，完全覆盖游程直接写入颜色。
+* lcd_set_glyph_format：设置之后缓存的字形使用的格式，格式改变时清空字形缓存与字符串缓存；未知的格式被忽略。
+*/
+typedef enum {
+    LCD_GLYPH_A8,           /* 8 位覆盖度 */
+    LCD_GLYPH_A4,           /* 4 位覆盖度 */
+    LCD_GLYPH_A4_RLE        /* 4 位覆盖度 + 游程编码 */
+} lcd_glyph_format_t;
+
+void lcd_set_glyph_format(lcd_glyph_format_t format);
+
+/*
+* 文字渲染方式
+* LCD_TEXT_EXACT：按字体大小精确光栅化字形（默认）。
+* LCD_TEXT_SDF：每个字形只缓存一份 32 像素大小的有向距离场，任意字体大小都由距离场采样得到，
+*               适合字体大小连续变化的缩放动画；小字号的笔画细节略逊于精确光栅化，不使用字符串缓存。
+* LCD_TEXT_MONO：无抗锯齿，覆盖度按阈值转为 1 位蒙版缓存，文字像素直接写入颜色、不读取帧缓冲，
+*                适合单色或小字号的工业屏；不使用字符串缓存。
+* lcd_set_text_mode：设置之后所有文本函数使用的渲染方式，可以在单次调用前后切换。
+*                   lcd_render_number 的数字精灵在 LCD_TEXT_MONO 方式下无抗锯齿，在 LCD_TEXT_SDF 方式下按精确光栅化生成。
+* lcd_set_sdf_cache_budget：设置距离场缓存的字节预算，默认 256KB，为 0 时不缓存。
+*/
+typedef enum {
+    LCD_TEXT_EXACT,         /* 精确光栅化 */
+    LCD_TEXT_SDF,           /* 距离场采样 */
+    LCD_TEXT_MONO           /* 1 位无抗锯齿 */
+} lcd_text_mode_t;
+
+void lcd_set_text_mode(lcd_text_mode_t mode);
+void lcd_set_sdf_cache_budget(size_t bytes);
+
+/*
+* 字形轮廓缓存
+* 按（字体，字形索引）缓存解析得到的轮廓顶点，同一字形换一个字体大小或亚像素偏移光栅化时不再解析 glyf 表。
+* lcd_set_outline_cache_budget：设置轮廓缓存的字节预算，默认 256KB，为 0 时不缓存。
+*/
+void lcd_set_outline_cache_budget(size_t bytes);
+
+/*
+* 数字快速渲染
+* 对（字体大小，文本颜色，背景颜色）组合预合成 0~9 . - : 和空格的 RGB565 精灵，数字与空格等宽，
+* 渲染时逐行复制像素而不做混合。其他字符先填充背景再普通渲染。适用于仪表盘等数值显示。
+*/
+void lcd_render_number( const char *text,     /* 数字文本，如 "-12.50" */
+                        int x, int y,         /* 文本起始坐标 */
+                        color_t text_color,   /* 文本颜色 */
+                        color_t bg_color,     /* 背景颜色 */
+                        int font_size         /* 字体大小 */
+                      );
+void lcd_render_number_n(const char *text, int len, /* 长度为 len 字节的数字文本 */
+                         int x, int y, color_t text_color, color_t bg_color, int font_size);
+
+/*
+* 文本槽（增量刷新的文本区域）
+* 适用于频繁变化的数值、时钟等显示。文本槽固定位置、字体大小、颜色和最大宽度，
+* 保存上一次字符串的排版结果，更新时只重绘码点或位置发生变化的字符单元。
+* lcd_text_slot_create：创建文本槽。x、y 是左上角坐标，max_width 是最大宽度（超出部分被裁剪），
+                        font_size 是字体大小，text_color 是文本颜色，bg_color 是背景颜色。失败返回 NULL。
+* lcd_text_slot_update：更新文本槽显示的字符串。第一次更新时整体绘制。
+* lcd_text_slot_update_n：同上，text 是长度为 len 字节的字符串，不要求以 '\0' 结尾。
+* lcd_text_slot_invalidate：文本槽所在区域被其他绘制覆盖后调用，下一次更新时整体重绘。
+* lcd_text_slot_destroy：释放文本槽，不改变屏幕内容。
+*/
+typedef struct lcd_text_slot lcd_text_slot_t;
+lcd_text_slot_t *lcd_text_slot_create(int x, int y,           /* 文本槽左上角坐标 */
+                                      int max_width,          /* 最大宽度 */
+                                      int font_size,          /* 字体大小 */
+                                      color_t text_color,     /* 文本颜色 */
+                                      color_t bg_color        /* 背景颜色 */
+                                     );
+void lcd_text_slot_update(lcd_text_slot_t *slot, const char *text);
+void lcd_text_slot_update_n(lcd_text_slot_t *slot, const char *text, int len);
+void lcd_text_slot_invalidate(lcd_text_slot_t *slot);
+void lcd_text_slot_destroy(lcd_text_slot_t *slot);
+
+/*
+* 裁剪矩形
+* lcd_push_clip：压入裁剪矩形（与当前裁剪矩形求交），之后所有绘制只影响该矩形内的像素，
+                 适用于滚动面板等局部绘制。成功返回 0，超过最大嵌套深度（16 层）返回 -1。
+* lcd_pop_clip：弹出裁剪矩形，恢复上一层裁剪。
+*/
+int lcd_push_clip(int x, int y, int width, int height);
+void lcd_pop_clip(void);
+
 /* 
 * 图形绘制函数
 * lcd_draw_rectangle：绘制矩形边框。x, y 是矩形左上角的坐标，width 和 height 是矩形的宽度和高度，
@@ -105,6 +292,17 @@ int lcd_get_text_height(void);                  /* 当前字体的文本高度 *
 * lcd_draw_filled_rounded_rectangle：绘制填充圆角矩形。 x, y 是矩形左上角的坐标，width 和 height 是矩形的宽度和高度，
                                      radius 是圆角的半径，color_t 是填充颜色。
 */
+void lcd_draw_pixel(int x, int y, color_t color);                   /* 绘制像素点 */
+void lcd_draw_line(int x1, int y1, int x2, int y2, color_t color);  /* 绘制直线（Bresenham 算法） */
+
+/*
+* 抗锯齿直线
+* lcd_draw_line_aa：绘制 1 像素宽的抗锯齿直线（Wu 算法）。
+* lcd_draw_thick_line：绘制宽度为 width 的抗锯齿粗直线，端点为平头，适用于趋势曲线等。
+*/
+void lcd_draw_line_aa(int x1, int y1, int x2, int y2, color_t color);
+void lcd_draw_thick_line(int x1, int y1, int x2, int y2, int width, color_t color);
+
 void lcd_draw_rectangle(int x, int y,   /* 文本起始坐标 */
                         int width,      /* 文本宽度 */
                         int height,     /* 文本高度 */
@@ -128,5 +326,226 @@ void lcd_draw_filled_rounded_rectangle(int x, int y,     /* 文本起始坐标 *
                                        color_t color     /* 文本颜色 */
                                       );
 
+/*
+* 离屏表面与复制
+* lcd_surface_create：创建离屏表面，初始内容全为 0。失败返回 NULL。
+* lcd_surface_destroy：释放离屏表面，若它是当前绘制目标则恢复为屏幕。
+* lcd_set_target：设置绘制目标，之后所有绘制与文本渲染函数都绘制到该表面，NULL 表示屏幕。
+* lcd_blit：把 src 中的矩形 (sx, sy, w, h) 复制到 dst 的 (dx, dy) 处，超出两侧表面的部分被裁剪。
+            同格式逐行 memcpy，不同格式逐像素转换。src、dst 为 NULL 表示屏幕。
+* lcd_blit_alpha：以 A8 表面 src 中的矩形为覆盖度，把 color 混合到 dst 的 (dx, dy) 处，dst 为 NULL 表示屏幕。
+* lcd_copy_area：把当前绘制目标中的矩形移动到 (dst_x, dst_y) 处，源与目标可以重叠，适用于滚动显示。
+                 源区域中未被覆盖的部分保持原内容，由调用者重绘新露出的部分。
+*/
+lcd_surface_t *lcd_surface_create(int width, int height, lcd_format_t format);
+void lcd_surface_destroy(lcd_surface_t *surface);
+void lcd_set_target(lcd_surface_t *surface);
+void lcd_blit(const lcd_surface_t *src,             /* 源表面 */
+              int sx, int sy, int w, int h,         /* 源矩形 */
+              lcd_surface_t *dst,                   /* 目标表面 */
+              int dx, int dy                        /* 目标坐标 */
+             );
+void lcd_blit_alpha(const lcd_surface_t *src,       /* 源 A8 表面 */
+                    int sx, int sy, int w, int h,   /* 源矩形 */
+                    lcd_surface_t *dst,             /* 目标表面 */
+                    int dx, int dy,                 /* 目标坐标 */
+                    color_t color                   /* 混合颜色 */
+                   );
+void lcd_copy_area(int x, int y,             /* 源矩形左上角坐标 */
+                   int width, int height,    /* 源矩形尺寸 */
+                   int dst_x, int dst_y      /* 目标坐标 */
+                  );
+
+/*
+* 页面缓存
+* 整页绘制到离屏表面后缓存，再次切换到该页面时只需一次整屏复制，切换过程没有逐个控件重绘。
+* lcd_page_cache_config：设置最多缓存的页面数、字节预算和是否 RLE 压缩（默认 10 页、4MB、压缩），
+                         调用时已缓存的页面全部释放。
+* lcd_page_show：显示编号为 page_id 的页面。已缓存时直接恢复；否则调用 draw(user) 把页面绘制到
+                 离屏表面（draw 中照常调用各绘制函数），再复制到屏幕并缓存。
+* lcd_page_invalidate：页面内容变化后调用，使该页面的缓存失效；page_id 为 -1 时使全部页面失效。
+*/
+void lcd_page_cache_config(int max_pages, size_t budget, int compress);
+void lcd_page_show(int page_id,                 /* 页面编号 */
+                   void (*draw)(void *user),    /* 页面绘制函数 */
+                   void *user                   /* 传给绘制函数的参数 */
+                  );
+void lcd_page_invalidate(int page_id);
+
+/*
+* 实时曲线（滚动波形图）
+* 适用于以固定频率刷新的传感器数据。曲线区域每列对应一个采样，内部用环形缓冲区保存最近 width 个采样，
+* 追加采样时把区域整体左移一列，只绘制新的一列。
+* lcd_chart_create：创建实时曲线。x、y 是左上角坐标，width、height 是区域尺寸，min、max 是纵轴量程，
+                    line_color 是曲线颜色，bg_color 是背景颜色。失败返回 NULL。
+* lcd_chart_push：追加一个采样并刷新显示。第一次追加时整体绘制。
+* lcd_chart_invalidate：曲线区域被其他绘制覆盖后调用，下一次追加采样时整体重绘。
+* lcd_chart_destroy：释放实时曲线，不改变屏幕内容。
+*/
+typedef struct lcd_chart lcd_chart_t;
+lcd_chart_t *lcd_chart_create(int x, int y,             /* 曲线区域左上角坐标 */
+                              int width, int height,    /* 曲线区域尺寸 */
+                              float min, float max,     /* 纵轴量程 */
+                              color_t line_color,       /* 曲线颜色 */
+                              color_t bg_color          /* 背景颜色 */
+                             );
+void lcd_chart_push(lcd_chart_t *chart, float value);
+void lcd_chart_invalidate(lcd_chart_t *chart);
+void lcd_chart_destroy(lcd_chart_t *chart);
+
+/*
+* 文本终端
+* 适用于滚动的诊断信息输出。终端是固定行列的字符网格，单元宽度由字体度量决定（取可打印 ASCII 字符的
+* 最大前进宽度），CJK 等宽字符占两个单元。每个单元有各自的前景色与背景色，追加文本时只重绘被改动的单元，
+* 滚动时用一次区域移动代替重新渲染所有行。
+* lcd_console_create：创建文本终端。x、y 是左上角坐标，cols、rows 是列数与行数，font_size 是字体大小，
+                      fg、bg 是初始前景色与背景色。失败返回 NULL。
+* lcd_console_write：追加文本，支持 \n、\r、\t 与 \b，超出行尾自动换行，超出最后一行自动滚动。
+* lcd_console_write_n：同上，text 是长度为 len 字节的文本，不要求以 '\0' 结尾。
+* lcd_console_printf：按 printf 的格式追加文本，返回格式化后的字节数。
+* lcd_console_set_color：设置之后追加文本的前景色与背景色。
+* lcd_console_clear：清空终端，光标回到左上角。
+* lcd_console_invalidate：终端区域被其他绘制覆盖后调用，下一次追加文本时整体重绘。
+* lcd_console_destroy：释放文本终端，不改变屏幕内容。
+*/
+typedef struct lcd_console lcd_console_t;
+lcd_console_t *lcd_console_create(int x, int y,         /* 终端左上角坐标 */
+                                  int cols, int rows,   /* 列数与行数 */
+                                  int font_size,        /* 字体大小 */
+                                  color_t fg,           /* 前景色 */
+                                  color_t bg            /* 背景色 */
+                                 );
+void lcd_console_write(lcd_console_t *con, const char *text);
+void lcd_console_write_n(lcd_console_t *con, const char *text, int len);
+int lcd_console_printf(lcd_console_t *con, const char *format, ...);
+void lcd_console_set_color(lcd_console_t *con, color_t fg, color_t bg);
+void lcd_console_clear(lcd_console_t *con);
+void lcd_console_invalidate(lcd_console_t *con);
+void lcd_console_destroy(lcd_console_t *con);
+
+/*
+* 段落排版（自动换行）
+* 按最大行宽对 UTF-8 文本分行，一次遍历累计笔位得到断行位置。CJK 字符之间可断行，拉丁文本在空格处断行，
+* 遵守基本的避头尾规则（。，等不出现在行首），\n 强制换行。排版结果可反复绘制。
+* lcd_layout_create：创建排版结果。font_size 是字体大小，max_width 是最大行宽，line_spacing 是行间距
+                     （行距为文本高度加 line_spacing）。失败返回 NULL。
+* lcd_layout_create_n：同上，text 是长度为 len 字节的文本，不要求以 '\0' 结尾。
+* lcd_layout_line_count / lcd_layout_height：返回行数与总高度（行数乘以行距）。
+* lcd_layout_get_line：查询第 index 行的行首字节偏移、字节数（不含换行符）和行宽，不需要的项传 NULL，越界返回 -1。
+* lcd_layout_draw：把排版结果绘制到以 (x, y) 为左上角、width x height 的框内，超出框的部分被裁剪。
+* lcd_layout_destroy：释放排版结果。
+*/
+typedef struct lcd_layout lcd_layout_t;
+lcd_layout_t *lcd_layout_create(const char *text,       /* 文本内容 */
+                                int font_size,          /* 字体大小 */
+                                int max_width,          /* 最大行宽 */
+                                int line_spacing        /* 行间距 */
+                               );
+lcd_layout_t *lcd_layout_create_n(const char *text, int len, int font_size, int max_width, int line_spacing);
+int lcd_layout_line_count(const lcd_layout_t *layout);
+int lcd_layout_height(const lcd_layout_t *layout);
+int lcd_layout_get_line(const lcd_layout_t *layout, int index, int *start, int *len, int *width);
+void lcd_layout_draw(const lcd_layout_t *layout,        /* 排版结果 */
+                     int x, int y,                      /* 框左上角坐标 */
+                     int width, int height,             /* 框尺寸 */
+                     color_t color                      /* 文本颜色 */
+                    );
+void lcd_layout_destroy(lcd_layout_t *layout);
+
+/*
+* 点击测试与光标位置
+* 使用排版结果中保存的累计笔位二分查找，不需要反复测量前缀，适用于触摸输入。坐标均相对排版左上角。
+* lcd_layout_hit_test：返回距离点击坐标 (x, y) 最近的光标位置的字节偏移，可直接用于 UTF-8 文本编辑。
+* lcd_layout_caret_x：返回字节偏移 offset 处光标的 x 坐标，y 不为 NULL 时存入光标所在行的上边界。
+*/
+int lcd_layout_hit_test(const lcd_layout_t *layout, int x, int y);
+int lcd_layout_caret_x(const lcd_layout_t *layout, int offset, int *y);
+
+/*
+* 长文档视图
+* 适用于数百 KB 的说明书、日志等可滚动显示。文件以只读方式映射到内存，只排版视口附近的段落，
+* 超过 4KB 的段落按 4KB 字节网格切分（切分处强制换行），滚动的开销与文档大小和段落长度无关；
+* 按行号跳转时通过稀疏的行号索引二分查找。
+* lcd_document_open：打开文本文件 path，按 max_width 自动换行，行距为文本高度加 line_spacing。失败返回 NULL。
+* lcd_document_scroll：视口滚动 lines 行（负数向上），到达文档首尾时停止，返回实际滚动的行数。
+* lcd_document_seek：视口跳转到字节偏移 offset 所在的行。
+* lcd_document_goto_line：视口跳转到第 line 行（从 0 开始）。
+* lcd_document_top_line：返回视口第一行的行号。
+* lcd_document_draw：把视口内容绘制到以 (x, y) 为左上角、width x height 的框内，不清除背景。
+* lcd_document_close：关闭文档视图，解除文件映射。
+*/
+typedef struct lcd_document lcd_document_t;
+lcd_document_t *lcd_document_open(const char *path,     /* 文本文件路径 */
+                                  int font_size,        /* 字体大小 */
+                                  int max_width,        /* 最大行宽 */
+                                  int line_spacing      /* 行间距 */
+                                 );
+int lcd_document_scroll(lcd_document_t *doc, int lines);
+void lcd_document_seek(lcd_document_t *doc, size_t offset);
+void lcd_document_goto_line(lcd_document_t *doc, int line);
+int lcd_document_top_line(lcd_document_t *doc);
+void lcd_document_draw(lcd_document_t *doc,             /* 文档视图 */
+                       int x, int y,                    /* 框左上角坐标 */
+                       int width, int height,           /* 框尺寸 */
+                       color_t color                    /* 文本颜色 */
+                      );
+void lcd_document_close(lcd_document_t *doc);
+
+/*
+* 流式文本输出
+* 把任意切分的字节流（如进程输出、tail -f 的文件描述符）直接显示到屏幕区域。每个新字符只在光标处渲染一次，
+* 超出行宽自动换行，超出最后一行自动上滚一行；输出过程不回看已输出的内容，也不分配内存。
+* lcd_stream_create：创建流式输出。x、y、width、height 是输出区域，font_size 是字体大小，fg、bg 是文本颜色与
+                     背景颜色，创建时区域填充为背景色。失败返回 NULL。
+* lcd_stream_write：输出 len 字节的 UTF-8 数据，块边界可以切断多字节序列，非法序列显示为 U+FFFD。
+                    支持 \n、\r（之后输出的内容覆盖本行）和 \t。
+* lcd_stream_read_fd：从 fd 读取一次（至多 4096 字节）并输出，返回 read 的结果。
+* lcd_stream_clear：清空输出区域，光标回到左上角。
+* lcd_stream_destroy：释放流式输出，不改变屏幕内容。
+*/
+typedef struct lcd_stream lcd_stream_t;
+lcd_stream_t *lcd_stream_create(int x, int y,           /* 输出区域左上角坐标 */
+                                int width, int height,  /* 输出区域尺寸 */
+                                int font_size,          /* 字体大小 */
+                                color_t fg,             /* 文本颜色 */
+                                color_t bg              /* 背景颜色 */
+                               );
+void lcd_stream_write(lcd_stream_t *stream, const char *data, size_t len);
+ssize_t lcd_stream_read_fd(lcd_stream_t *stream, int fd);
+void lcd_stream_clear(lcd_stream_t *stream);
+void lcd_stream_destroy(lcd_stream_t *stream);
+
+/*
+* 可编辑文本框
+* 单行文本框，保存文本与每个字符的笔位。插入、删除时只重新计算编辑点处的笔位与字距调整，
+* 屏幕上只重绘从编辑点到行尾的部分，按键延迟与文本长度基本无关。超出文本框宽度的部分被裁剪。
+* 所有位置均为字节偏移，与 lcd_layout_hit_test 相同。
+* lcd_edit_create：创建文本框。x、y 是左上角坐标，width 是宽度（高度由字体大小决定），font_size 是字体大小，
+                   fg、bg 是文本颜色与背景颜色。创建时文本为空，区域填充为背景色。失败返回 NULL。
+* lcd_edit_insert：在 offset 处插入文本，返回插入内容之后的偏移（新的光标位置），失败返回 -1。
+* lcd_edit_delete：删除 [offset, offset + len)，范围向外取整到完整字符，返回删除后的光标位置。
+                   退格为 lcd_edit_delete(edit, caret - 1, 1)，向后删除为 lcd_edit_delete(edit, caret, 1)。
+* lcd_edit_set_text：替换全部文本并整体重绘。
+* lcd_edit_text：返回当前文本。
+* lcd_edit_hit_test / lcd_edit_caret_x：点击 x 坐标与光标位置之间的转换，x 相对文本框左边界。
+* lcd_edit_invalidate：文本框区域被其他绘制覆盖后调用，下一次编辑时整体重绘。
+* lcd_edit_destroy：释放文本框，不改变屏幕内容。
+*/
+typedef struct lcd_edit lcd_edit_t;
+lcd_edit_t *lcd_edit_create(int x, int y,       /* 文本框左上角坐标 */
+                            int width,          /* 文本框宽度 */
+                            int font_size,      /* 字体大小 */
+                            color_t fg,         /* 文本颜色 */
+                            color_t bg          /* 背景颜色 */
+                           );
+int lcd_edit_insert(lcd_edit_t *edit, int offset, const char *text);
+int lcd_edit_delete(lcd_edit_t *edit, int offset, int len);
+void lcd_edit_set_text(lcd_edit_t *edit, const char *text);
+const char *lcd_edit_text(const lcd_edit_t *edit);
+int lcd_edit_hit_test(const lcd_edit_t *edit, int x);
+int lcd_edit_caret_x(const lcd_edit_t *edit, int offset);
+void lcd_edit_invalidate(lcd_edit_t *edit);
+void lcd_edit_destroy(lcd_edit_t *edit);
+
 /* 结束头文件保护 */
 #endif /* LCD_FONT_H */ 
\ No newline at end of file